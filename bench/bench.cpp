@@ -0,0 +1,141 @@
+// runs every benchmark script a number of times and prints one json object per script, so the results of two commits
+// can be diffed line by line. a script declares how many operations one run performs in a `// ops: n` comment
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Run {
+    double      milliseconds;
+    long        peak_rss; // kilobytes
+    std::string stats;    // what --gc-stats printed
+    bool        failed;
+};
+
+std::string lox_path = "./lox";
+
+std::vector<std::string> flags;
+
+size_t runs = 5;
+
+size_t operations(const std::string& script) {
+    std::ifstream file(script);
+    std::string   line;
+    while (std::getline(file, line))
+        if (line.starts_with("// ops: "))
+            return std::stoull(line.substr(8));
+    return 0;
+}
+
+std::string name(const std::string& script) {
+    const size_t start = script.find_last_of('/') + 1;
+    const size_t end   = script.rfind(".lox");
+    return script.substr(start, end == std::string::npos or end < start ? std::string::npos : end - start);
+}
+
+Run run(const std::string& script) {
+    int stats[2];
+    if (pipe(stats) != 0)
+        return {0, 0, "", true};
+    const auto  start = std::chrono::steady_clock::now();
+    const pid_t pid   = fork();
+    if (pid == 0) {
+        const int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(stats[1], STDERR_FILENO);
+        close(stats[0]);
+        std::vector<char*> argv{lox_path.data()};
+        for (std::string& flag : flags)
+            argv.push_back(flag.data());
+        argv.push_back(const_cast<char*>("--gc-stats"));
+        argv.push_back(const_cast<char*>(script.c_str()));
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    close(stats[1]);
+    std::string output;
+    char        buffer[4096];
+    for (ssize_t count; (count = read(stats[0], buffer, sizeof(buffer))) > 0;)
+        output.append(buffer, count);
+    close(stats[0]);
+    int           status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return {milliseconds, usage.ru_maxrss, output, !WIFEXITED(status) or WEXITSTATUS(status) != 0};
+}
+
+// the total from the "[gc] n objects allocated" line
+size_t allocations(const std::string& stats) {
+    const size_t end = stats.find(" objects allocated");
+    if (end == std::string::npos)
+        return 0;
+    const size_t start = stats.rfind(' ', end - 1) + 1;
+    return std::stoull(stats.substr(start, end - start));
+}
+
+};
+
+int main(int argc, char* argv[]) {
+    const char*              usage = "usage bench [--lox=path] [--runs=n] [--flag=lox flag]... script...\n";
+    std::vector<std::string> scripts;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.starts_with("--lox="))
+            lox_path = arg.substr(6);
+        else if (arg.starts_with("--runs=") and arg.size() > 7 and arg.find_first_not_of("0123456789", 7) == std::string::npos)
+            runs = std::max(1ul, std::stoul(arg.substr(7)));
+        else if (arg.starts_with("--flag="))
+            flags.push_back(arg.substr(7));
+        else if (arg.starts_with("--")) {
+            std::cerr << usage;
+            return 64;
+        } else
+            scripts.push_back(arg);
+    }
+    if (scripts.empty()) {
+        std::cerr << usage;
+        return 64;
+    }
+
+    int failures = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const std::string& script : scripts) {
+        const size_t ops = operations(script);
+        // the first run is not counted, it warms the page cache and writes the tree cache
+        Run              warmup = run(script);
+        std::vector<Run> results;
+        for (size_t i = 0; i < runs and !warmup.failed; i++)
+            results.push_back(run(script));
+        if (warmup.failed or std::any_of(results.begin(), results.end(), [](const Run& run) { return run.failed; })) {
+            std::cerr << name(script) << " failed\n" << warmup.stats;
+            std::cout << "{\"benchmark\": \"" << name(script) << "\", \"failed\": true}\n";
+            failures++;
+            continue;
+        }
+        std::sort(results.begin(), results.end(), [](const Run& a, const Run& b) { return a.milliseconds < b.milliseconds; });
+        const double median = results[results.size() / 2].milliseconds;
+        long         peak   = 0;
+        for (const Run& result : results)
+            peak = std::max(peak, result.peak_rss);
+        std::cout << "{\"benchmark\": \"" << name(script) << "\", \"runs\": " << results.size()
+                  << ", \"median_ms\": " << median << ", \"min_ms\": " << results.front().milliseconds
+                  << ", \"max_ms\": " << results.back().milliseconds
+                  << ", \"ns_per_op\": " << (ops ? median * 1e6 / ops : 0) << ", \"ops\": " << ops
+                  << ", \"peak_rss_kb\": " << peak << ", \"allocations\": " << allocations(results.front().stats) << "}\n";
+        std::cout.flush();
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,269 @@
+// times the interpreter's components one at a time on generated inputs and prints one json object per component. where
+// the kernel allows it, cycles, instructions, cache misses and branch misses of the timed sections are read through
+// perf_event_open, otherwise those fields are null
+
+#include "environment.hpp"
+#include "error.hpp"
+#include "interpreter.hpp"
+#include "lox_class.hpp"
+#include "lox_instance.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
+#include "scanner.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr auto MIN_TIME = std::chrono::milliseconds(300); // per component, after one untimed warmup round
+
+// keeps the compiler from dropping a result nobody reads
+template <class T> void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// a group of hardware counters that only count while enabled and only in user space
+class Counters {
+
+public:
+    static constexpr int COUNT = 4;
+
+    static constexpr const char* NAMES[COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+private:
+    static constexpr uint64_t EVENTS[COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    int fds[COUNT] = {-1, -1, -1, -1};
+
+public:
+    Counters() {
+        for (int i = 0; i < COUNT; i++) {
+            perf_event_attr attr = {};
+            attr.type            = PERF_TYPE_HARDWARE;
+            attr.size            = sizeof(attr);
+            attr.config          = EVENTS[i];
+            attr.disabled        = i == 0; // the leader starts and stops the whole group
+            attr.exclude_kernel  = 1;
+            attr.exclude_hv      = 1;
+            attr.read_format     = PERF_FORMAT_GROUP;
+            fds[i]               = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0);
+            if (fds[i] == -1) {
+                close_all();
+                return;
+            }
+        }
+    }
+
+    ~Counters() {
+        close_all();
+    }
+
+    void close_all() {
+        for (int& fd : fds)
+            if (fd != -1)
+                close(std::exchange(fd, -1));
+    }
+
+    bool available() const {
+        return fds[0] != -1;
+    }
+
+    void reset() {
+        if (available())
+            ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+
+    void enable() {
+        if (available())
+            ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    void disable() {
+        if (available())
+            ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    bool read_values(uint64_t (&values)[COUNT]) {
+        uint64_t buffer[1 + COUNT];
+        if (!available() or read(fds[0], buffer, sizeof(buffer)) != sizeof(buffer) or buffer[0] != COUNT)
+            return false;
+        std::memcpy(values, buffer + 1, sizeof(values));
+        return true;
+    }
+};
+
+Counters counters;
+
+// calls setup untimed and body timed until enough time went by, body returns the operations it performed
+void measure(const std::string& name, const std::string& unit, const std::function<void()>& setup,
+             const std::function<size_t()>& body) {
+    setup();
+    keep(body());
+    counters.reset();
+    std::chrono::steady_clock::duration elapsed{};
+    size_t                              ops    = 0;
+    size_t                              rounds = 0;
+    while (elapsed < MIN_TIME) {
+        setup();
+        counters.enable();
+        const auto start = std::chrono::steady_clock::now();
+        ops += body();
+        elapsed += std::chrono::steady_clock::now() - start;
+        counters.disable();
+        rounds++;
+    }
+    const double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << "{\"component\": \"" << name << "\", \"unit\": \"" << unit << "\", \"rounds\": " << rounds
+              << ", \"ops\": " << ops << ", \"ns_per_op\": " << nanoseconds / ops;
+    uint64_t   values[Counters::COUNT];
+    const bool counted = counters.read_values(values);
+    for (int i = 0; i < Counters::COUNT; i++) {
+        std::cout << ", \"" << Counters::NAMES[i] << "_per_op\": ";
+        if (counted)
+            std::cout << static_cast<double>(values[i]) / ops;
+        else
+            std::cout << "null";
+    }
+    std::cout << "}\n";
+    std::cout.flush();
+}
+
+// a bit of everything the grammar has, repeated with varying names and numbers
+std::string generate_source(const int functions) {
+    std::string source;
+    for (int i = 0; i < functions; i++) {
+        const std::string n = std::to_string(i);
+        source += "// function " + n + "\n";
+        source += "fun f" + n + "(a, b) {\n";
+        source += "  var x = a + b * " + n + ".5;\n";
+        source += "  var s = \"string " + n + "\";\n";
+        source += "  for (var i = 0; i < " + n + "; i = i + 1) {\n";
+        source += "    if (x > i and !(s == nil)) x = x - 1; else x = x + 2;\n";
+        source += "  }\n";
+        source += "  fun inner() { return x + a; }\n";
+        source += "  while (x >= 0) x = x - inner();\n";
+        source += "  return -x;\n";
+        source += "}\n";
+        source += "class C" + n + (i > 0 ? " < C" + std::to_string(i - 1) : std::string()) + " {\n";
+        source += "  init(v) { this.v = v; }\n";
+        source += "  get() { return this.v / " + n + " + f" + n + "(this.v, 1); }\n";
+        source += "}\n";
+        source += "print C" + n + "(" + n + ").get();\n";
+    }
+    return source;
+}
+
+};
+
+int main() {
+    if (!counters.available())
+        std::cerr << "hardware counters unavailable, reporting time only\n";
+    std::cout << std::fixed << std::setprecision(3);
+
+    const std::string       source = generate_source(2000);
+    std::vector<lox::Token> tokens = lox::Scanner(source).scan_tokens();
+    if (lox::had_error)
+        return 70;
+
+    measure(
+        "scanner", "token", [] {},
+        [&] {
+            std::vector<lox::Token> scanned = lox::Scanner(source).scan_tokens();
+            return scanned.size();
+        });
+
+    // tokens cannot be assigned, the copy is rebuilt instead. the tree is freed before the next round starts
+    std::vector<lox::Token>                 copy;
+    std::vector<std::unique_ptr<lox::Stmt>> statements;
+    measure(
+        "parser", "token",
+        [&] {
+            statements.clear();
+            copy.clear();
+            for (const lox::Token& token : tokens)
+                copy.push_back(token);
+        },
+        [&] {
+            statements = lox::Parser(std::move(copy)).parse();
+            return tokens.size();
+        });
+
+    measure(
+        "resolver", "token", [&] { statements = lox::Parser(tokens).parse(); },
+        [&] {
+            lox::Resolver resolver;
+            resolver.resolve(statements);
+            return tokens.size();
+        });
+    if (lox::had_error)
+        return 70;
+
+    // eight nested scopes of eight slots each, read from the innermost one
+    constexpr int              DEPTH = 8;
+    constexpr int              SLOTS = 8;
+    lox::Ref<lox::Environment> environment;
+    for (int depth = 0; depth < DEPTH; depth++) {
+        environment = lox::make_ref<lox::Environment>(environment, SLOTS);
+        for (int slot = 0; slot < SLOTS; slot++)
+            environment->define(static_cast<double>(depth * SLOTS + slot));
+    }
+    measure(
+        "environment_get_at", "lookup", [] {},
+        [&] {
+            double sum = 0;
+            for (int i = 0; i < 1000000; i++) {
+                const lox::Value value = environment->get_at(i % DEPTH, (i / DEPTH) % SLOTS);
+                sum += value.as_number();
+            }
+            keep(sum);
+            return size_t(1000000);
+        });
+
+    // numbers, booleans, nil, strings and instances, the objects among them are reference counted on every copy
+    auto                    klass = lox::make_ref<lox::LoxClass>("Point", lox::SymbolMap<lox::Ref<lox::LoxCallable>>{}, nullptr);
+    std::vector<lox::Value> values;
+    for (int i = 0; i < 1024; i++) {
+        switch (i % 5) {
+        case 0: values.emplace_back(static_cast<double>(i)); break;
+        case 1: values.emplace_back(i % 2 == 0); break;
+        case 2: values.emplace_back(); break;
+        case 3: values.emplace_back("value " + std::to_string(i % 16)); break;
+        case 4: values.emplace_back(lox::make_ref<lox::LoxInstance>(klass)); break;
+        }
+    }
+    std::vector<lox::Value> copies(values.size());
+    measure(
+        "value_copy", "copy", [] {},
+        [&] {
+            for (int round = 0; round < 1000; round++)
+                for (size_t i = 0; i < values.size(); i++)
+                    copies[i] = values[(i + round) % values.size()];
+            keep(copies.data());
+            return 1000 * values.size();
+        });
+
+    lox::Interpreter interpreter;
+    measure(
+        "interpreter_is_equal", "comparison", [] {},
+        [&] {
+            size_t equal = 0;
+            for (int round = 0; round < 1000; round++)
+                for (size_t i = 0; i < values.size(); i++)
+                    equal += interpreter.is_equal(values[i], values[(i * 7 + round) % values.size()]);
+            keep(equal);
+            return 1000 * values.size();
+        });
+    return 0;
+}
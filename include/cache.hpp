@@ -0,0 +1,28 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include "stmt.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox {
+
+// the resolved tree of a script is kept in a .loxc file in the user's cache directory, so later runs can skip
+// scanning, parsing and resolving. a cache only counts while the format version, the build of the interpreter, the source length and the
+// source hash it was written for match, and while the checksum over its contents holds.
+// lexemes are stored as offsets into the source, which has to stay around exactly like it does after a scan
+// where the cache of a script goes: $XDG_CACHE_HOME/lox, or ~/.cache/lox, under a hash of the script's absolute
+// path. empty when neither directory is known
+std::string cache_path(const std::string&);
+
+bool load_cache(const std::string&, std::string_view, std::vector<std::unique_ptr<Stmt>>&);
+
+// best effort, a cache that cannot be written is simply not there next time
+void save_cache(const std::string&, std::string_view, const std::vector<std::unique_ptr<Stmt>>&);
+
+};
+
+#endif
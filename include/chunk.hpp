@@ -0,0 +1,90 @@
+#ifndef CHUNK_HPP
+#define CHUNK_HPP
+
+#include "shape.hpp"
+#include "token.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+enum OpCode : uint8_t {
+    OP_CONSTANT,      // u16 constant
+    OP_NIL,
+    OP_TRUE,
+    OP_FALSE,
+    OP_POP,
+    OP_GET_LOCAL,     // u8 slot
+    OP_SET_LOCAL,     // u8 slot
+    OP_GET_GLOBAL,    // u16 global
+    OP_DEFINE_GLOBAL, // u16 global
+    OP_SET_GLOBAL,    // u16 global
+    OP_GET_UPVALUE,   // u8 upvalue
+    OP_SET_UPVALUE,   // u8 upvalue
+    OP_GET_PROPERTY,  // u16 name constant, u16 inline cache
+    OP_SET_PROPERTY,  // u16 name constant, u16 inline cache
+    OP_GET_SUPER,     // u16 name constant
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_LESSER,
+    OP_LESSER_EQUAL,
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_DIVIDE,
+    OP_NOT,
+    OP_NEGATE,
+    OP_PRINT,
+    OP_JUMP,          // u16 forward offset
+    OP_JUMP_IF_FALSE, // u16 forward offset
+    OP_LOOP,          // u16 backward offset
+    OP_CALL,          // u8 argument count
+    OP_INVOKE,        // u16 name constant, u8 argument count
+    OP_SUPER_INVOKE,  // u16 name constant, u8 argument count
+    OP_CLOSURE,       // u16 function, then (u8 is_local, u8 index) per upvalue
+    OP_CLOSE_UPVALUE,
+    OP_RETURN,
+    OP_CLASS,         // u16 name constant
+    OP_INHERIT,
+    OP_METHOD,        // u16 name constant
+    OP_LIST,          // u16 capacity
+    OP_APPEND,
+    OP_MAP,           // u16 capacity
+    OP_INSERT,
+    OP_GET_INDEX,
+    OP_SET_INDEX,
+};
+
+struct Prototype;
+
+struct Chunk {
+    std::vector<uint8_t>                    code;
+    std::vector<unsigned>                   lines;
+    std::vector<Value>                      constants;
+    std::vector<std::shared_ptr<Prototype>> functions;
+    std::vector<InlineCache>                caches;
+
+    void   write(const uint8_t, const unsigned);
+    size_t add_constant(Value);
+    size_t add_function(std::shared_ptr<Prototype>);
+    size_t add_cache();
+};
+
+// compiled form of a function body, shared by every closure created from it
+struct Prototype {
+    std::string name;
+    size_t      arity         = 0;
+    size_t      upvalue_count = 0;
+    Chunk       chunk;
+
+    Prototype(std::string name) : name(std::move(name)) {}
+};
+
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include "chunk.hpp"
+#include "expression.hpp"
+#include "stmt.hpp"
+#include "vm.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lox {
+
+// lowers a resolved program to bytecode for the vm, locals live in stack slots and captured ones become upvalues.
+// variables are found through the locations the resolver stored, which are the tree-walker's frames and environments,
+// so the compiler keeps track of which vm local each of those slots ended up in
+class Compiler : ExprVisitor, StmtVisitor {
+
+    enum class FunctionType {
+        FUNCTION,
+        INITIALIZER,
+        METHOD,
+        SCRIPT,
+    };
+
+    struct Local {
+        int  depth;
+        bool captured;
+    };
+
+    struct UpvalueRef {
+        uint8_t index;
+        bool    is_local;
+    };
+
+    struct FunctionState {
+        FunctionState*                                 enclosing;
+        std::shared_ptr<Prototype>                     function;
+        FunctionType                                   type;
+        bool                                           framed;
+        std::vector<Local>                             locals;
+        std::vector<UpvalueRef>                        upvalues;
+        std::unordered_map<std::string_view, uint16_t> names;
+        std::vector<uint8_t>                           frame; // frame slot to local, for a framed function
+        int                                            scope_depth = 0;
+
+        FunctionState(FunctionState* enclosing, std::shared_ptr<Prototype> function, FunctionType type, bool framed)
+            : enclosing(enclosing), function(std::move(function)), type(type), framed(framed) {}
+    };
+
+    // an environment the tree-walker would create, its slots in the order they were declared
+    struct Scope {
+        FunctionState*       function;
+        std::vector<uint8_t> slots;
+    };
+
+    VM&                vm;
+    FunctionState*     current = nullptr;
+    std::vector<Scope> scopes;
+    unsigned           line = 0;
+
+    Chunk& chunk();
+
+    void     emit(const uint8_t);
+    void     emit(const uint8_t, const uint8_t);
+    void     emit_short(const uint8_t, const uint16_t);
+    size_t   emit_jump(const uint8_t);
+    void     patch_jump(const size_t);
+    void     emit_loop(const size_t);
+    void     emit_return();
+    void     emit_constant(Value);
+    void     emit_property(const uint8_t, std::string_view);
+    uint16_t make_constant(Value);
+    uint16_t identifier_constant(std::string_view);
+
+    void begin_scope();
+    void end_scope();
+    int  add_local();
+    int  resolve_upvalue(FunctionState&, FunctionState&, const uint8_t);
+    int  add_upvalue(FunctionState&, const uint8_t, const bool);
+
+    std::pair<FunctionState*, uint8_t> locate(const lox::Local&);
+
+    void load_variable(const lox::Local&, std::string_view);
+    void store_variable(const lox::Local&, std::string_view);
+    int  define_variable(std::string_view);
+    void function(FnStmt&, const FunctionType);
+
+    void compile(const std::unique_ptr<Stmt>&);
+    void compile(const std::unique_ptr<Expr>&);
+
+    Value visit(AssignExpr&) override;
+    Value visit(BinaryExpr&) override;
+    Value visit(CallExpr&) override;
+    Value visit(GetExpr&) override;
+    Value visit(GroupingExpr&) override;
+    Value visit(IndexExpr&) override;
+    Value visit(IndexSetExpr&) override;
+    Value visit(ListExpr&) override;
+    Value visit(LiteralExpr&) override;
+    Value visit(MapExpr&) override;
+    Value visit(LogicalExpr&) override;
+    Value visit(SetExpr&) override;
+    Value visit(SuperExpr&) override;
+    Value visit(ThisExpr&) override;
+    Value visit(UnaryExpr&) override;
+    Value visit(VariableExpr&) override;
+
+    void visit(BlockStmt&) override;
+    void visit(ClassStmt&) override;
+    void visit(FnStmt&) override;
+    void visit(IfStmt&) override;
+    void visit(VarStmt&) override;
+    void visit(PrintStmt&) override;
+    void visit(ExprStmt&) override;
+    void visit(ReturnStmt&) override;
+    void visit(WhileStmt&) override;
+
+public:
+    Compiler(VM& vm) : vm(vm) {}
+
+    std::shared_ptr<Prototype> compile(std::vector<std::unique_ptr<Stmt>>&);
+};
+
+};
+
+#endif
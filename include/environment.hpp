@@ -5,24 +5,41 @@
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace lox {
 
-struct Environment : public std::enable_shared_from_this<Environment> {
+// locals are addressed by the (depth, slot) pair the resolver assigned, in declaration order
+struct Environment : Object {
 
-    std::unordered_map<std::string, Value> values;
-    std::shared_ptr<Environment>           enclosing;
+    std::vector<Value> values;
+    Ref<Environment>   enclosing;
 
 public:
-    Environment(std::shared_ptr<Environment> enclosing = nullptr) : enclosing(std::move(enclosing)) {}
+    Environment(Ref<Environment> enclosing = nullptr, const size_t size = 0) : Object(ObjectType::ENVIRONMENT), enclosing(std::move(enclosing)) {
+        values.reserve(size);
+    }
 
-    void define(const std::string&, Value);
+    void trace(Tracer&) override;
+    void clear() override;
+
+    void define(Value);
+    void assign_at(const int, const int, Value);
+
+    Environment* ancestor(const int);
+    Value        get_at(const int, const int);
+};
+
+// top level variables are late bound, so they stay keyed by their interned name
+struct GlobalEnvironment {
+
+    SymbolMap<Value> values;
+
+public:
+    void define(Ref<LoxString>, Value);
     void assign(const Token&, Value);
-    void assign_at(const int, const Token&, Value);
 
-    std::shared_ptr<Environment> ancestor(const int);
-    Value                        get(const Token&);
-    Value                        get_at(const int, const std::string&);
+    Value get(const Token&);
 };
 
 };
@@ -10,13 +10,16 @@ namespace lox {
 extern bool had_error;
 extern bool had_runtime_error;
 
+void report(const int, const std::string&, const std::string&);
+
 void error(const std::string&, const int);
 
 void error(const Token&, const std::string&);
 
 struct RuntimeError : public std::runtime_error {
-    const Token& token;
-    RuntimeError(const Token& token, const std::string& message) : token(token), std::runtime_error(message) {}
+    const unsigned line;
+    RuntimeError(const Token& token, const std::string& message) : std::runtime_error(message), line(token.line) {}
+    RuntimeError(const unsigned line, const std::string& message) : std::runtime_error(message), line(line) {}
 };
 
 void runtime_error(const RuntimeError&);
@@ -1,6 +1,7 @@
 #ifndef EXPRESSION_HPP
 #define EXPRESSION_HPP
 
+#include "shape.hpp"
 #include "token.hpp"
 
 #include <memory>
@@ -13,7 +14,11 @@ struct BinaryExpr;
 struct CallExpr;
 struct GetExpr;
 struct GroupingExpr;
+struct IndexExpr;
+struct IndexSetExpr;
+struct ListExpr;
 struct LiteralExpr;
+struct MapExpr;
 struct LogicalExpr;
 struct SetExpr;
 struct SuperExpr;
@@ -27,7 +32,11 @@ struct ExprVisitor {
     virtual Value visit(CallExpr&)     = 0;
     virtual Value visit(GetExpr&)      = 0;
     virtual Value visit(GroupingExpr&) = 0;
+    virtual Value visit(IndexExpr&)    = 0;
+    virtual Value visit(IndexSetExpr&) = 0;
+    virtual Value visit(ListExpr&)     = 0;
     virtual Value visit(LiteralExpr&)  = 0;
+    virtual Value visit(MapExpr&)      = 0;
     virtual Value visit(LogicalExpr&)  = 0;
     virtual Value visit(SetExpr&)      = 0;
     virtual Value visit(SuperExpr&)    = 0;
@@ -37,12 +46,33 @@ struct ExprVisitor {
 };
 
 struct Expr {
+    virtual ~Expr() = default;
+
     virtual Value accept(ExprVisitor&) = 0;
 };
 
+// where the resolver found a variable: a global, a slot in the stack frame of a function nothing captures, or a
+// slot in the environment `depth` scopes out
+struct Local {
+    static constexpr int GLOBAL = -1;
+    static constexpr int FRAME  = -2;
+
+    int depth = GLOBAL;
+    int slot  = 0;
+
+    bool is_global() const {
+        return depth == GLOBAL;
+    }
+
+    bool is_frame() const {
+        return depth == FRAME;
+    }
+};
+
 struct AssignExpr : Expr {
     Token                 name;
     std::unique_ptr<Expr> value;
+    Local                 local;
 
     AssignExpr(Token name, std::unique_ptr<Expr> value) : name(std::move(name)), value(std::move(value)) {}
 
@@ -51,10 +81,27 @@ struct AssignExpr : Expr {
     }
 };
 
+// what the tree-walker has rewritten a binary expression into. a site starts out uninitialized, specializes on the
+// operand types it sees first and drops to generic for good once a guard fails, so it cannot flip back and forth
+enum class Specialization : uint8_t {
+    UNINITIALIZED,
+    GENERIC,
+    NUMBER_ADD,
+    NUMBER_SUBTRACT,
+    NUMBER_MULTIPLY,
+    NUMBER_DIVIDE,
+    NUMBER_GREATER,
+    NUMBER_GREATER_EQUAL,
+    NUMBER_LESSER,
+    NUMBER_LESSER_EQUAL,
+    STRING_CONCAT,
+};
+
 struct BinaryExpr : Expr {
     std::unique_ptr<Expr> left;
     Token                 op;
     std::unique_ptr<Expr> right;
+    Specialization        specialization = Specialization::UNINITIALIZED;
 
     BinaryExpr(std::unique_ptr<Expr> left, Token token, std::unique_ptr<Expr> right)
         : left(std::move(left)), op(std::move(token)), right(std::move(right)) {}
@@ -68,9 +115,11 @@ struct CallExpr : Expr {
     std::unique_ptr<Expr>              callee;
     Token                              paren;
     std::vector<std::unique_ptr<Expr>> arguments;
+    GetExpr*                           method; // the callee when it is a property access, null otherwise
+    SuperExpr*                         super;  // the callee when it is a super method, null otherwise
 
-    CallExpr(std::unique_ptr<Expr> callee, Token paren, std::vector<std::unique_ptr<Expr>> arguments)
-        : callee(std::move(callee)), paren(std::move(paren)), arguments(std::move(arguments)) {}
+    CallExpr(std::unique_ptr<Expr> callee, Token paren, std::vector<std::unique_ptr<Expr>> arguments, GetExpr* method, SuperExpr* super)
+        : callee(std::move(callee)), paren(std::move(paren)), arguments(std::move(arguments)), method(method), super(super) {}
 
     Value accept(ExprVisitor& visitor) override {
         return visitor.visit(*this);
@@ -80,6 +129,7 @@ struct CallExpr : Expr {
 struct GetExpr : Expr {
     std::unique_ptr<Expr> object;
     Token                 name;
+    InlineCache           cache;
 
     GetExpr(std::unique_ptr<Expr> object, Token name) : object(std::move(object)), name(std::move(name)) {}
 
@@ -98,6 +148,45 @@ struct GroupingExpr : Expr {
     }
 };
 
+struct IndexExpr : Expr {
+    std::unique_ptr<Expr> object;
+    Token                 bracket;
+    std::unique_ptr<Expr> index;
+
+    IndexExpr(std::unique_ptr<Expr> object, Token bracket, std::unique_ptr<Expr> index)
+        : object(std::move(object)), bracket(std::move(bracket)), index(std::move(index)) {}
+
+    Value accept(ExprVisitor& visitor) override {
+        return visitor.visit(*this);
+    }
+};
+
+struct IndexSetExpr : Expr {
+    std::unique_ptr<Expr> object;
+    Token                 bracket;
+    std::unique_ptr<Expr> index;
+    std::unique_ptr<Expr> value;
+
+    IndexSetExpr(std::unique_ptr<Expr> object, Token bracket, std::unique_ptr<Expr> index, std::unique_ptr<Expr> value)
+        : object(std::move(object)), bracket(std::move(bracket)), index(std::move(index)), value(std::move(value)) {}
+
+    Value accept(ExprVisitor& visitor) override {
+        return visitor.visit(*this);
+    }
+};
+
+struct ListExpr : Expr {
+    Token                              bracket;
+    std::vector<std::unique_ptr<Expr>> elements;
+
+    ListExpr(Token bracket, std::vector<std::unique_ptr<Expr>> elements)
+        : bracket(std::move(bracket)), elements(std::move(elements)) {}
+
+    Value accept(ExprVisitor& visitor) override {
+        return visitor.visit(*this);
+    }
+};
+
 struct LiteralExpr : Expr {
     Value value;
 
@@ -121,10 +210,25 @@ struct LogicalExpr : Expr {
     }
 };
 
+// keys and values in the order they are written, keys[i] goes with values[i]
+struct MapExpr : Expr {
+    Token                              brace;
+    std::vector<std::unique_ptr<Expr>> keys;
+    std::vector<std::unique_ptr<Expr>> values;
+
+    MapExpr(Token brace, std::vector<std::unique_ptr<Expr>> keys, std::vector<std::unique_ptr<Expr>> values)
+        : brace(std::move(brace)), keys(std::move(keys)), values(std::move(values)) {}
+
+    Value accept(ExprVisitor& visitor) override {
+        return visitor.visit(*this);
+    }
+};
+
 struct SetExpr : Expr {
     std::unique_ptr<Expr> object;
     std::unique_ptr<Expr> value;
     Token                 name;
+    InlineCache           cache;
 
     SetExpr(std::unique_ptr<Expr> object, std::unique_ptr<Expr> value, Token name)
         : object(std::move(object)), value(std::move(value)), name(std::move(name)) {}
@@ -137,6 +241,10 @@ struct SetExpr : Expr {
 struct SuperExpr : Expr {
     Token keyword;
     Token method;
+    Local local;
+    Local receiver; // where `this` lives
+    Value superclass; // the class the method was last looked up in
+    Value resolved;
 
     SuperExpr(Token keyword, Token method) : keyword(std::move(keyword)), method(std::move(method)) {}
 
@@ -147,6 +255,7 @@ struct SuperExpr : Expr {
 
 struct ThisExpr : Expr {
     Token keyword;
+    Local local;
 
     ThisExpr(Token keyword) : keyword(std::move(keyword)) {}
 
@@ -168,6 +277,7 @@ struct UnaryExpr : Expr {
 
 struct VariableExpr : Expr {
     Token name;
+    Local local;
 
     VariableExpr(Token name) : name(std::move(name)) {}
 
@@ -5,26 +5,45 @@
 #include "expression.hpp"
 #include "stmt.hpp"
 
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace lox {
 
+class LoxCallable;
+class Profiler;
+class Sampler;
+
 class Interpreter : ExprVisitor, StmtVisitor {
 
 public:
-    std::shared_ptr<Environment> globals = std::make_shared<Environment>();
+    GlobalEnvironment globals;
+    Profiler*         profiler = nullptr; // set while --profile is on
+    Sampler*          sampler  = nullptr; // set while --sample is on
 
 private:
-    std::shared_ptr<Environment>   environment = globals;
-    std::unordered_map<Expr*, int> locals;
+    Ref<Environment> environment; // null while running top level code
+
+    static constexpr size_t STACK_MAX = 65536;
 
-    bool is_truthy(const Value&) const;
-    bool is_equal(const Value&, const Value&) const;
+    std::unique_ptr<Value[]> stack     = std::make_unique<Value[]>(STACK_MAX); // arguments of the calls in progress
+    Value*                   stack_top = stack.get();
+    Value*                   frame     = nullptr; // slots of the framed function running right now
+
+    // a return statement stores its value and raises the flag, blocks and loops stop early until the call picks it up
+    bool  returning = false;
+    Value returned;
 
     void check_number_operand(const Token&, const Value&) const;
     void check_number_operands(const Token&, const Value&, const Value&) const;
 
-    void execute(std::unique_ptr<Stmt>&);
+    Specialization specialize(const TokenType, const Value&, const Value&) const;
+    Value          binary(BinaryExpr&, const Value&, const Value&);
+
+    void  execute(std::unique_ptr<Stmt>&);
+    void  execute_all(std::vector<std::unique_ptr<Stmt>>&);
+    Value take_returned();
 
     Value evaluate(Expr&);
     Value evaluate(std::unique_ptr<Expr>&);
@@ -34,7 +53,11 @@ private:
     Value visit(CallExpr&) override;
     Value visit(GetExpr&) override;
     Value visit(GroupingExpr&) override;
+    Value visit(IndexExpr&) override;
+    Value visit(IndexSetExpr&) override;
+    Value visit(ListExpr&) override;
     Value visit(LiteralExpr&) override;
+    Value visit(MapExpr&) override;
     Value visit(LogicalExpr&) override;
     Value visit(SetExpr&) override;
     Value visit(SuperExpr&) override;
@@ -52,13 +75,23 @@ private:
     void visit(ReturnStmt&) override;
     void visit(WhileStmt&) override;
 
-    Value lookup_variable(const Token&, Expr*);
+    void         define(const Token&, Value);
+    Value        lookup_variable(const Token&, const Local&);
+    Value        invoke(CallExpr&, GetExpr&);
+    Value        invoke_super(CallExpr&, SuperExpr&);
+    Value        call(CallExpr&, Value);
+    Value        call_with_arguments(CallExpr&, LoxCallable&, const Value*);
+    void         pop(Value*);
+    LoxCallable* super_method(SuperExpr&);
 
 public:
     Interpreter();
-    void        execute_block(std::vector<std::unique_ptr<Stmt>>&, std::shared_ptr<Environment>);
+    void        execute_block(std::vector<std::unique_ptr<Stmt>>&, Ref<Environment>);
+    Value       execute_body(std::vector<std::unique_ptr<Stmt>>&, Ref<Environment>);
+    Value       execute_frame(FnStmt&, Ref<Environment>, const Value*, std::span<Value>);
     void        interpret(std::vector<std::unique_ptr<Stmt>>&);
-    void        resolve(Expr*, const int);
+    bool        is_truthy(const Value&) const;
+    bool        is_equal(const Value&, const Value&) const;
     std::string stringfy(const Value&) const;
 };
 
@@ -1,19 +1,40 @@
 #ifndef LOX_HPP
 #define LOX_HPP
 
+#include "stmt.hpp"
 #include "token.hpp"
 
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace lox {
 
+enum class Engine {
+    TREE,
+    VM,
+};
+
 void run_file(const std::string&);
 
 void run_prompt();
 
-void run(const std::string&);
+void run(std::string_view);
+
+std::vector<std::unique_ptr<Stmt>> parse(std::string_view);
+
+void execute(std::vector<std::unique_ptr<Stmt>>);
+
+void report_optimizer();
+
+void report_profile();
+
+void report_samples();
+
+void report_gc();
 
-void report(const int, const std::string&, const std::string&);
+void report_stats();
 
 };
 
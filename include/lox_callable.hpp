@@ -3,14 +3,31 @@
 
 #include "interpreter.hpp"
 
+#include <span>
+
 namespace lox {
 
-class LoxCallable {
+class LoxInstance;
+
+// arguments stay on the caller's stack, a callable reads (or moves) them in place and must not keep the span
+using Arguments = std::span<Value>;
+
+class LoxCallable : public Object {
 
 public:
-    virtual size_t      arity()                                 = 0;
-    virtual Value       call(Interpreter&, std::vector<Value>&) = 0;
-    virtual std::string to_string() const                       = 0;
+    LoxCallable(const ObjectType type) : Object(type) {}
+
+    virtual size_t      arity()                      = 0;
+    virtual Value       call(Interpreter&, Arguments) = 0;
+    virtual std::string to_string() const            = 0;
+
+    // methods override this to attach their receiver, everything else is never stored in a class
+    virtual Ref<LoxCallable> bind(Ref<LoxInstance>) {
+        return nullptr;
+    }
+
+    // calls a method with `this` supplied directly, methods override it to skip the bound method bind() allocates
+    virtual Value call_method(Interpreter&, const Value&, Arguments);
 };
 
 };
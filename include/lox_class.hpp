@@ -9,21 +9,34 @@
 
 namespace lox {
 
-class LoxClass : public LoxCallable, public std::enable_shared_from_this<LoxClass> {
+class LoxClass : public LoxCallable {
 
-    std::unordered_map<std::string, std::shared_ptr<LoxFunction>> methods;
-    std::shared_ptr<LoxClass>                                     superclass = nullptr;
+    friend class VM;
+
+    // inherited methods are copied down when the class is built, so a lookup never walks the superclass chain
+    SymbolMap<Ref<LoxCallable>> methods;
+    Ref<LoxClass>               superclass = nullptr;
+    Ref<LoxCallable>            init       = nullptr;
+
+    void inherit(Ref<LoxClass>);
+    void add_method(Ref<LoxString>, Ref<LoxCallable>);
 
 public:
     const std::string name;
+    bool              frozen = false; // instances keep the fields they were built with, as modules do
+
+    LoxClass(std::string, SymbolMap<Ref<LoxCallable>>, Ref<LoxClass> superclass = nullptr);
 
-    LoxClass(std::string name, std::unordered_map<std::string, std::shared_ptr<LoxFunction>> methods, std::shared_ptr<LoxClass> superclass = nullptr)
-        : name(std::move(name)), methods(std::move(methods)), superclass(std::move(superclass)) {}
+    void             trace(Tracer&) override;
+    void             clear() override;
+    size_t           arity() override;
+    Value            call(Interpreter&, Arguments) override;
+    Ref<LoxCallable> find_method(const LoxString*);
+    std::string      to_string() const override;
 
-    size_t                       arity() override;
-    Value                        call(Interpreter&, std::vector<Value>&) override;
-    std::shared_ptr<LoxFunction> find_method(const std::string&);
-    std::string                  to_string() const override;
+    const Ref<LoxCallable>& initializer() const {
+        return init;
+    }
 };
 
 };
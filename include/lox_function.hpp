@@ -9,19 +9,28 @@ class LoxInstance;
 
 class LoxFunction : public LoxCallable {
 
-    FnStmt&                      declaration;
-    std::shared_ptr<Environment> closure;
+    FnStmt&          declaration;
+    Ref<Environment> closure;
+    Value            receiver; // set once a method is bound
 
     bool is_init;
+    bool is_method; // methods find `this` in the first slot of their own environment
 
-public:
-    LoxFunction(FnStmt& declaration, std::shared_ptr<Environment> closure, bool is_init)
-        : declaration(declaration), closure(std::move(closure)), is_init(is_init) {}
+    Value invoke(Interpreter&, const Value*, Arguments);
 
-    size_t                       arity() override;
-    std::shared_ptr<LoxFunction> bind(std::shared_ptr<LoxInstance>);
-    Value                        call(Interpreter&, std::vector<Value>&) override;
-    std::string                  to_string() const override;
+public:
+    LoxFunction(FnStmt& declaration, Ref<Environment> closure, bool is_init, bool is_method = false, Value receiver = {})
+        : LoxCallable(ObjectType::FUNCTION), declaration(declaration), closure(std::move(closure)), receiver(std::move(receiver)),
+          is_init(is_init), is_method(is_method) {}
+
+    void  trace(Tracer&) override;
+    void  clear() override;
+    Value call_method(Interpreter&, const Value&, Arguments) override;
+
+    size_t           arity() override;
+    Ref<LoxCallable> bind(Ref<LoxInstance>) override;
+    Value            call(Interpreter&, Arguments) override;
+    std::string      to_string() const override;
 };
 
 };
@@ -2,22 +2,34 @@
 #define LOX_INSTANCE_HPP
 
 #include "lox_class.hpp"
+#include "shape.hpp"
 
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 namespace lox {
 
-class LoxInstance : public std::enable_shared_from_this<LoxInstance> {
+class LoxInstance : public Object {
 
-    std::shared_ptr<LoxClass>              klass;
-    std::unordered_map<std::string, Value> fields;
+    friend class Interpreter;
+    friend class VM;
+
+    Ref<LoxClass>      klass;
+    Shape*             shape = Shape::root();
+    std::vector<Value> fields; // laid out as the shape says
 
 public:
-    LoxInstance(std::shared_ptr<LoxClass> klass) : klass(std::move(klass)) {}
+    LoxInstance(Ref<LoxClass> klass) : Object(ObjectType::INSTANCE), klass(std::move(klass)) {}
+
+    void trace(Tracer&) override;
+    void clear() override;
+
+    Value* field(const LoxString*);
+    Value* field(const LoxString*, InlineCache&);
+    void   set_field(LoxString*, Value, InlineCache&);
 
-    Value       get(const Token& name);
-    void        set(const Token& name, Value value);
+    Value       get(const Token& name, InlineCache&);
+    void        set(const Token& name, Value value, InlineCache&);
     std::string to_string() const;
 };
 
@@ -0,0 +1,30 @@
+#ifndef LOX_LIST_HPP
+#define LOX_LIST_HPP
+
+#include "native.hpp"
+
+#include <vector>
+
+namespace lox {
+
+// a growable array of values, stored contiguously so indexing is a bounds check and a load
+class LoxList : public Object {
+
+public:
+    std::vector<Value> elements;
+
+    LoxList(std::vector<Value> elements = {}) : Object(ObjectType::LIST), elements(std::move(elements)) {}
+
+    void trace(Tracer&) override;
+    void clear() override;
+
+    // the element at a whole number index inside the list, throws NativeError for anything else
+    Value& at(const Value&);
+
+    // length, push, pop, sort and slice, null for any other name
+    static BuiltinMethod<LoxList>* method(const LoxString*);
+};
+
+};
+
+#endif
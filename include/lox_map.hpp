@@ -0,0 +1,59 @@
+#ifndef LOX_MAP_HPP
+#define LOX_MAP_HPP
+
+#include "native.hpp"
+
+#include <vector>
+
+namespace lox {
+
+// a hash table keyed by strings, numbers and booleans. entries sit inline in one array and collisions probe linearly,
+// so a lookup usually touches a single cache line. strings are interned, their hash is computed once when they are made
+// and comparing two of them compares pointers
+class LoxMap : public Object {
+
+    // an empty slot has a nil key and a nil value, a removed one a nil key and a true value so probing goes past it
+    struct Entry {
+        Value key;
+        Value value;
+    };
+
+    std::vector<Entry> entries; // the size is zero or a power of two
+    size_t             count = 0;
+    size_t             used  = 0; // live entries and removed ones, what the load factor is measured on
+
+    Entry& slot(const Value& key, size_t hash);
+    void   resize(size_t capacity);
+
+public:
+    LoxMap() : Object(ObjectType::MAP) {}
+
+    void trace(Tracer&) override;
+    void clear() override;
+
+    size_t size() const {
+        return count;
+    }
+
+    // room for that many entries without growing
+    void reserve(size_t);
+
+    // these throw NativeError for a key that is not a string, a number other than NaN or a boolean
+    Value* find(const Value& key);
+    void   set(const Value& key, Value value);
+    bool   remove(const Value& key);
+
+    // calls back with every key and value, in table order
+    template <class F> void for_each(F callback) const {
+        for (const Entry& entry : entries)
+            if (!entry.key.is_nil())
+                callback(entry.key, entry.value);
+    }
+
+    // length, has, remove, keys and values, null for any other name
+    static BuiltinMethod<LoxMap>* method(const LoxString*);
+};
+
+};
+
+#endif
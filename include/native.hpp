@@ -0,0 +1,188 @@
+#ifndef NATIVE_HPP
+#define NATIVE_HPP
+
+#include "lox_callable.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace lox {
+
+class LoxInstance;
+
+// thrown by natives, the engine that made the call turns it into a runtime error on the line of the call
+struct NativeError : public std::runtime_error {
+    NativeError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// how a lox value reaches a c++ parameter. strings are viewed in place and other values passed by reference, so no
+// argument is copied on the way in
+template <class T> struct Parameter;
+
+template <> struct Parameter<double> {
+    static constexpr const char* type = "a number";
+    static bool                  accepts(const Value& value) {
+        return value.is_number();
+    }
+    static double get(const Value& value) {
+        return value.as_number();
+    }
+};
+
+template <> struct Parameter<bool> {
+    static constexpr const char* type = "a boolean";
+    static bool                  accepts(const Value& value) {
+        return value.is_bool();
+    }
+    static bool get(const Value& value) {
+        return value.as_bool();
+    }
+};
+
+template <> struct Parameter<std::string_view> {
+    static constexpr const char* type = "a string";
+    static bool                  accepts(const Value& value) {
+        return value.is_string();
+    }
+    static std::string_view get(const Value& value) {
+        return value.as_string();
+    }
+};
+
+template <> struct Parameter<const Value&> {
+    static constexpr const char* type = "a value";
+    static bool                  accepts(const Value&) {
+        return true;
+    }
+    static const Value& get(const Value& value) {
+        return value;
+    }
+};
+
+// wraps a plain c++ function, its parameter types decide the arity and the checks made before every call. numbers,
+// booleans, strings, values and nothing at all can be returned
+template <class R, class... Params> class NativeFunction : public LoxCallable {
+
+    std::string name;
+    R (*function)(Params...);
+
+    template <size_t... I> Value invoke(Arguments arguments, std::index_sequence<I...>) {
+        (check<Params>(arguments[I], I), ...);
+        if constexpr (std::is_void_v<R>) {
+            function(Parameter<Params>::get(arguments[I])...);
+            return {};
+        } else if constexpr (std::is_arithmetic_v<R> and !std::is_same_v<R, bool>)
+            return static_cast<double>(function(Parameter<Params>::get(arguments[I])...));
+        else
+            return Value(function(Parameter<Params>::get(arguments[I])...));
+    }
+
+    template <class P> void check(const Value& argument, const size_t index) const {
+        if (!Parameter<P>::accepts(argument))
+            throw NativeError(
+                "Expected " + std::string(Parameter<P>::type) + " as argument " + std::to_string(index + 1) + " of " + name
+            );
+    }
+
+public:
+    NativeFunction(std::string name, R (*function)(Params...))
+        : LoxCallable(ObjectType::NATIVE), name(std::move(name)), function(function) {}
+
+    size_t arity() override {
+        return sizeof...(Params);
+    }
+
+    Value call(Interpreter&, Arguments arguments) override {
+        return invoke(arguments, std::index_sequence_for<Params...>{});
+    }
+
+    std::string to_string() const override {
+        return "<fn " + name + ">";
+    }
+};
+
+template <class R, class... Params> Ref<LoxCallable> make_native(std::string name, R (*function)(Params...)) {
+    return make_ref<NativeFunction<R, Params...>>(std::move(name), function);
+}
+
+// a method built into a value type such as lists. it is handed its receiver directly and has no meaning without one
+template <class T> class BuiltinMethod : public LoxCallable {
+
+    std::string name;
+    size_t      params;
+    Value (*function)(T&, Arguments);
+
+public:
+    BuiltinMethod(std::string name, size_t params, Value (*function)(T&, Arguments))
+        : LoxCallable(ObjectType::NATIVE), name(std::move(name)), params(params), function(function) {}
+
+    size_t arity() override {
+        return params;
+    }
+
+    // only reachable through a bound builtin method, which supplies the receiver
+    Value call(Interpreter&, Arguments) override {
+        throw NativeError(name + " called without a receiver");
+    }
+
+    Value call_method(Interpreter&, const Value& receiver, Arguments arguments) override {
+        return function(*receiver.template as<T>(), arguments);
+    }
+
+    std::string to_string() const override {
+        return "<fn " + name + ">";
+    }
+};
+
+// a builtin method taken off its receiver without calling it. like a bound lox function it holds the receiver, so it is
+// traced
+class BoundBuiltinMethod : public LoxCallable {
+
+    Value            receiver;
+    Ref<LoxCallable> method;
+
+public:
+    BoundBuiltinMethod(Value receiver, Ref<LoxCallable> method)
+        : LoxCallable(ObjectType::FUNCTION), receiver(std::move(receiver)), method(std::move(method)) {}
+
+    void trace(Tracer&) override;
+    void clear() override;
+
+    size_t      arity() override;
+    Value       call(Interpreter&, Arguments) override;
+    std::string to_string() const override;
+};
+
+// the builtin method of a list or a map with that name, null for an unknown name or any other receiver
+LoxCallable* builtin_method(const Value& receiver, const LoxString* name);
+
+// a named group of natives and constants, reached from lox as the fields of a global instance: math.sqrt(2). scripts
+// cannot assign to those fields
+class Module {
+
+    std::string      name;
+    Ref<LoxInstance> instance;
+
+public:
+    Module(std::string name);
+
+    void constant(std::string_view, Value);
+
+    template <class R, class... Params> Module& function(std::string_view function_name, R (*function)(Params...)) {
+        constant(function_name, make_native(name + "." + std::string(function_name), function));
+        return *this;
+    }
+
+    // adds the module to the globals under its name
+    void define(GlobalEnvironment&);
+};
+
+// clock() and the math, string and time modules
+void define_natives(GlobalEnvironment&);
+
+};
+
+#endif
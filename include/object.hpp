@@ -0,0 +1,191 @@
+#ifndef OBJECT_HPP
+#define OBJECT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace lox {
+
+// callables are kept last so a single comparison tells them apart
+enum class ObjectType : uint8_t {
+    STRING,
+    ENVIRONMENT,
+    UPVALUE,
+    INSTANCE,
+    LIST,
+    MAP,
+    NATIVE,
+    FUNCTION,
+    CLASS,
+    CLOSURE,
+    BOUND_METHOD,
+};
+
+constexpr size_t OBJECT_TYPES = static_cast<size_t>(ObjectType::BOUND_METHOD) + 1;
+
+class Tracer;
+
+struct GcNode {
+    GcNode* prev = this;
+    GcNode* next = this;
+
+    void unlink() {
+        prev->next = next;
+        next->prev = prev;
+        prev = next = this;
+    }
+
+    void append(GcNode* node) {
+        node->prev = prev;
+        node->next = this;
+        prev->next = node;
+        prev       = node;
+    }
+};
+
+// everything a value can point at, reference counted in place so a value only needs the raw pointer. objects that can
+// hold other objects are also linked into the heap so cycles the counts can never free are found by the collector
+struct Object : GcNode {
+    uint32_t         refs = 0;
+    const ObjectType type;
+    uint8_t          generation = 0;
+    int64_t          gc_refs    = 0;
+
+    Object(const ObjectType);
+    virtual ~Object();
+
+    bool traced() const {
+        return type != ObjectType::STRING and type != ObjectType::NATIVE;
+    }
+
+    // reports every object this one holds a counted reference to
+    virtual void trace(Tracer&) {}
+    // drops those references, only called on objects the collector found unreachable
+    virtual void clear() {}
+};
+
+template <class T> class Ref {
+
+    template <class U> friend class Ref;
+
+    T* ptr = nullptr;
+
+    void retain() const {
+        if (ptr)
+            static_cast<Object*>(ptr)->refs++;
+    }
+
+    void release() const {
+        if (ptr and --static_cast<Object*>(ptr)->refs == 0)
+            delete ptr;
+    }
+
+public:
+    Ref() = default;
+    Ref(std::nullptr_t) {}
+    explicit Ref(T* ptr) : ptr(ptr) {
+        retain();
+    }
+    Ref(const Ref& other) : ptr(other.ptr) {
+        retain();
+    }
+    Ref(Ref&& other) noexcept : ptr(std::exchange(other.ptr, nullptr)) {}
+    template <class U> Ref(const Ref<U>& other) : ptr(other.ptr) {
+        retain();
+    }
+    template <class U> Ref(Ref<U>&& other) noexcept : ptr(std::exchange(other.ptr, nullptr)) {}
+
+    ~Ref() {
+        release();
+    }
+
+    Ref& operator=(Ref other) noexcept {
+        std::swap(ptr, other.ptr);
+        return *this;
+    }
+
+    T* get() const {
+        return ptr;
+    }
+
+    T* operator->() const {
+        return ptr;
+    }
+
+    T& operator*() const {
+        return *ptr;
+    }
+
+    explicit operator bool() const {
+        return ptr != nullptr;
+    }
+
+    // hands the reference over to the caller without touching the count
+    T* detach() {
+        return std::exchange(ptr, nullptr);
+    }
+
+    bool operator==(const Ref& other) const {
+        return ptr == other.ptr;
+    }
+
+    bool operator==(std::nullptr_t) const {
+        return ptr == nullptr;
+    }
+};
+
+struct GcStats {
+    size_t collections = 0;
+    size_t freed       = 0;
+    double total_pause = 0; // milliseconds
+    double max_pause   = 0;
+};
+
+// generational cycle collector. reference counting frees everything that is not part of a cycle, the collector only
+// looks at traced objects: a reference that cannot be accounted for by another traced object of the collected
+// generations comes from outside (a stack, a global, a c++ local) and makes the object a root
+class Heap {
+
+public:
+    static constexpr int GENERATIONS = 3;
+
+private:
+    GcNode generations[GENERATIONS];
+    bool   collecting = false;
+
+public:
+    // generation 0 is collected once allocations minus frees exceed its threshold, older generations once the
+    // generation below them has been collected that many times
+    size_t  thresholds[GENERATIONS] = {700, 10, 10};
+    size_t  counts[GENERATIONS]     = {0, 0, 0};
+    GcStats stats[GENERATIONS];
+    size_t  tracked                 = 0;
+    size_t  allocated[OBJECT_TYPES] = {}; // objects ever created, traced or not
+    size_t  live                    = 0;
+    size_t  peak_live               = 0;
+    bool    due                     = false;
+    bool    enabled                 = true;
+
+    void track(Object*);
+    void untrack(Object*);
+    void collect(const int);
+    void collect_due();
+};
+
+inline Heap& heap() {
+    static Heap* heap = new Heap(); // never destroyed, objects are still released during static destruction
+    return *heap;
+}
+
+// allocating is the only point where the collector runs, the new object is already held so it is a root itself
+template <class T, class... Args> Ref<T> make_ref(Args&&... args) {
+    Ref<T> object(new T(std::forward<Args>(args)...));
+    if (heap().due)
+        heap().collect_due();
+    return object;
+}
+
+};
+
+#endif
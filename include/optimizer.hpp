@@ -0,0 +1,64 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "expression.hpp"
+#include "interpreter.hpp"
+#include "stmt.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace lox {
+
+// rewrites a resolved tree in place: expressions over literals are folded into a single literal, groupings are
+// unwrapped and branches whose condition is a literal are pruned. runs after the resolver so dead code still gets
+// checked, the locations it stored on the surviving nodes stay valid
+class Optimizer : ExprVisitor, StmtVisitor {
+
+    const Interpreter& interpreter; // folding has to agree with the engines on truthiness and string conversion
+
+    std::unique_ptr<Expr> folded;          // set by a visit when its expression is replaced
+    std::unique_ptr<Stmt> pruned;          // set by a visit when its statement is replaced
+    bool                  removed = false; // set by a visit when its statement can go away entirely
+
+    void optimize(std::unique_ptr<Expr>&);
+    void optimize(std::unique_ptr<Stmt>&); // a statement that has to stay becomes an empty block when it is removed
+    void optimize_all(std::vector<std::unique_ptr<Stmt>>&);
+
+    void visit(BlockStmt&) override;
+    void visit(ClassStmt&) override;
+    void visit(ExprStmt&) override;
+    void visit(FnStmt&) override;
+    void visit(IfStmt&) override;
+    void visit(PrintStmt&) override;
+    void visit(ReturnStmt&) override;
+    void visit(VarStmt&) override;
+    void visit(WhileStmt&) override;
+
+    Value visit(AssignExpr&) override;
+    Value visit(BinaryExpr&) override;
+    Value visit(CallExpr&) override;
+    Value visit(GetExpr&) override;
+    Value visit(GroupingExpr&) override;
+    Value visit(IndexExpr&) override;
+    Value visit(IndexSetExpr&) override;
+    Value visit(ListExpr&) override;
+    Value visit(LiteralExpr&) override;
+    Value visit(MapExpr&) override;
+    Value visit(LogicalExpr&) override;
+    Value visit(SetExpr&) override;
+    Value visit(SuperExpr&) override;
+    Value visit(ThisExpr&) override;
+    Value visit(UnaryExpr&) override;
+    Value visit(VariableExpr&) override;
+
+public:
+    Optimizer(const Interpreter& interpreter) : interpreter(interpreter) {}
+
+    // returns how many nodes were eliminated
+    size_t optimize(std::vector<std::unique_ptr<Stmt>>&);
+};
+
+};
+
+#endif
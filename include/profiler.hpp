@@ -0,0 +1,95 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include "object.hpp"
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+// deterministic profiler for the tree walker. every call of a lox function or class is timed on entry and exit and
+// every executed statement bumps the hit count of its line. self time excludes the calls made from a function,
+// inclusive time counts a recursive function only once, from its outermost call
+class Profiler {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Function {
+        std::string     name;
+        size_t          calls = 0;
+        Clock::duration self{};
+        Clock::duration inclusive{};
+        unsigned        active = 0; // calls of this function currently on the stack
+    };
+
+    // one node per distinct call path, the root is the script itself
+    struct Node {
+        size_t                   function;
+        std::map<size_t, size_t> children; // function -> node
+        Clock::duration          self{};
+    };
+
+    struct Frame {
+        size_t            function;
+        size_t            node;
+        Clock::time_point start;
+        Clock::duration   children{};
+    };
+
+    std::unordered_map<const void*, size_t> index;
+    std::vector<Function>                   functions;
+    std::vector<Node>                       nodes;
+    std::vector<Frame>                      frames;
+    std::vector<Ref<Object>>                pinned; // keeps keys that are objects from being reused by another one
+    std::vector<size_t>                     lines;
+    Clock::time_point                       start = Clock::now();
+    Clock::duration                         called{}; // time spent in calls made from the top level
+
+    void write_folded(std::ostream&, const Node&, std::string&) const;
+
+public:
+    Profiler();
+
+    void hit(const unsigned line) {
+        if (line >= lines.size())
+            lines.resize(line + 1);
+        lines[line]++;
+    }
+
+    // a key identifies a function across calls, name and line are only looked at the first time a key is seen. functions
+    // are reported as name:line, classes without a line
+    void enter(const void*, std::string_view, unsigned, Object* = nullptr);
+    void exit();
+
+    void report(std::ostream&) const;
+    // one line per call path, frames separated by ';' followed by the self time in microseconds
+    void write_folded(std::ostream&) const;
+
+    // closes the call it opened however the call is left
+    class Scope {
+        Profiler* profiler;
+
+    public:
+        Scope(Profiler* profiler, const void* key, std::string_view name, unsigned line, Object* pin = nullptr)
+            : profiler(profiler) {
+            if (profiler)
+                profiler->enter(key, name, line, pin);
+        }
+        ~Scope() {
+            if (profiler)
+                profiler->exit();
+        }
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+};
+
+#endif
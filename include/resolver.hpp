@@ -1,9 +1,12 @@
 #ifndef RESOLVER_HPP
 #define RESOLVER_HPP
 
-#include "interpreter.hpp"
+#include "expression.hpp"
+#include "stmt.hpp"
 
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace lox {
 
@@ -22,22 +25,39 @@ class Resolver : public ExprVisitor, StmtVisitor {
         SUBCLASS,
     };
 
-    Interpreter&                                       interpreter;
-    std::vector<std::unordered_map<std::string, bool>> scopes;
-    FunctionType                                       current_function = FunctionType::NONE;
-    ClassType                                          current_class    = ClassType::NONE;
+    struct Variable {
+        bool defined;
+        int  slot;
+    };
+
+    struct Scope {
+        std::unordered_map<std::string_view, Variable> variables;
+        int                                            slots  = 0; // a redeclared name gets a fresh slot, just like at runtime
+        bool                                           framed = false;
+    };
+
+    std::vector<Scope> scopes;
+    FunctionType       current_function = FunctionType::NONE;
+    ClassType          current_class    = ClassType::NONE;
+
+    // while resolving a framed function its scopes share one frame, a block gives its slots back when it ends
+    bool framing     = false;
+    int  frame_slots = 0;
+    int  frame_size  = 0;
 
     void resolve(const std::unique_ptr<Expr>&);
     void resolve(const std::unique_ptr<VariableExpr>&);
     void resolve(const std::unique_ptr<Stmt>&);
-    void resolve_function(const FnStmt&, const FunctionType);
-    void resolve_local(Expr&, const Token&);
+    void resolve_function(FnStmt&, const FunctionType);
+    void resolve_local(Local&, std::string_view);
 
     void begin_scope();
-    void end_scope();
+    int  end_scope();
 
     void declare(const Token&);
+    void declare(std::string_view);
     void define(const Token&);
+    void define(std::string_view);
 
     void visit(BlockStmt&) override;
     void visit(ClassStmt&) override;
@@ -54,7 +74,11 @@ class Resolver : public ExprVisitor, StmtVisitor {
     Value visit(CallExpr&) override;
     Value visit(GetExpr&) override;
     Value visit(GroupingExpr&) override;
+    Value visit(IndexExpr&) override;
+    Value visit(IndexSetExpr&) override;
+    Value visit(ListExpr&) override;
     Value visit(LiteralExpr&) override;
+    Value visit(MapExpr&) override;
     Value visit(LogicalExpr&) override;
     Value visit(SetExpr&) override;
     Value visit(SuperExpr&) override;
@@ -63,8 +87,6 @@ class Resolver : public ExprVisitor, StmtVisitor {
     Value visit(VariableExpr&) override;
 
 public:
-    Resolver(Interpreter& interpreter) : interpreter(interpreter) {}
-
     void resolve(const std::vector<std::unique_ptr<Stmt>>&);
 };
 
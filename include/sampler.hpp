@@ -0,0 +1,113 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include "stmt.hpp"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace lox {
+
+// statistical profiler for the tree walker. the interpreter keeps a shadow stack of the functions it is in and the line
+// each of them is executing, a timer interrupts the interpreter thread at a fixed rate and the signal handler
+// copies that stack into a lock free ring buffer. a background thread drains the ring and aggregates the samples
+class Sampler {
+
+public:
+    static constexpr size_t DEPTH = 128; // frames past this depth are not recorded, their time goes to the last one
+
+private:
+    static constexpr size_t RING_SIZE = 256; // samples, drained every few ticks
+
+    struct Frame {
+        const FnStmt*         function = nullptr; // null for the top level
+        std::atomic<unsigned> line     = 0;
+    };
+
+    struct Sample {
+        size_t        depth;
+        const FnStmt* functions[DEPTH];
+        unsigned      line; // executed by the innermost frame
+    };
+
+    // only touched by the interpreter thread and the signal handler interrupting it
+    Frame               frames[DEPTH];
+    std::atomic<size_t> depth = 0;
+
+    std::unique_ptr<Sample[]> ring    = std::make_unique<Sample[]>(RING_SIZE);
+    std::atomic<size_t>       head    = 0; // written by the signal handler
+    std::atomic<size_t>       tail    = 0; // written by the drain thread
+    std::atomic<size_t>       dropped = 0; // ticks that found the ring full
+
+    std::map<std::vector<const FnStmt*>, size_t> stacks;
+    std::vector<size_t>                          lines;
+    size_t                                       samples = 0;
+
+    unsigned          frequency = 0;
+    timer_t           timer;
+    std::thread       drainer;
+    std::atomic<bool> running = false;
+
+    static void tick(int);
+    void        sample();
+    void        drain();
+
+public:
+    static constexpr unsigned DEFAULT_FREQUENCY = 1000;
+
+    ~Sampler();
+
+    // false if the timer could not be set up
+    bool start(const unsigned);
+    void stop();
+
+    void enter(const FnStmt* function) {
+        const size_t current = depth.load(std::memory_order_relaxed) + 1;
+        if (current < DEPTH) {
+            frames[current].function = function;
+            frames[current].line.store(function->line, std::memory_order_relaxed);
+        }
+        std::atomic_signal_fence(std::memory_order_release);
+        depth.store(current, std::memory_order_relaxed);
+    }
+
+    void exit() {
+        depth.store(depth.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+
+    void at(const unsigned line) {
+        if (const size_t current = depth.load(std::memory_order_relaxed); current < DEPTH)
+            frames[current].line.store(line, std::memory_order_relaxed);
+    }
+
+    // stops sampling first, the report covers everything sampled until then
+    void report(std::ostream&);
+    // one line per sampled stack, frames separated by ';' followed by the number of samples
+    void write_folded(std::ostream&);
+
+    // pops the frame it pushed however the call is left
+    class Scope {
+        Sampler* sampler;
+
+    public:
+        Scope(Sampler* sampler, const FnStmt* function) : sampler(sampler) {
+            if (sampler)
+                sampler->enter(function);
+        }
+        ~Scope() {
+            if (sampler)
+                sampler->exit();
+        }
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+};
+
+#endif
@@ -4,14 +4,14 @@
 #include "token.hpp"
 
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace lox {
 
 class Scanner {
 
-    const std::string& source;
-    const size_t       length;
     std::vector<Token> tokens;
 
     const char* src_start;
@@ -21,6 +21,23 @@ class Scanner {
 
     size_t line = 1;
 
+    // a chunk of a larger source is scanned on a worker thread: nothing is interned, errors are collected instead of
+    // reported and a string still open at the end of a chunk that is not the last one is left for the caller
+    bool                                          chunk     = false;
+    bool                                          more      = false;
+    const char*                                   open      = nullptr;
+    size_t                                        open_line = 0;
+    std::vector<std::pair<unsigned, std::string>> errors;
+
+    Scanner(std::string_view source, const bool more) : Scanner(source) {
+        this->chunk = true;
+        this->more  = more;
+    }
+
+    void scan_error(const std::string&);
+    void scan();
+    void stitch(std::vector<Token>&, const unsigned) const;
+
     char advance();
     bool match(const char);
     char peek() const;
@@ -33,6 +50,10 @@ class Scanner {
     bool is_alpha_or_underscore(const char) const;
     bool is_alnum_or_underscore(const char) const;
 
+    void skip_blanks();
+    void skip_comment();
+    void skip_identifier();
+
     void check_string();
     void check_number();
     void check_identifier();
@@ -40,9 +61,12 @@ class Scanner {
     void scan_token();
 
 public:
-    Scanner(const std::string& source)
-        : source(source), length(source.length()), src_start(&source[0]), start(src_start), src_end(src_start + length), current(start) {}
+    Scanner(std::string_view source)
+        : src_start(source.data()), src_end(source.data() + source.size()), start(src_start), current(src_start) {}
     std::vector<Token> scan_tokens();
+
+    // splits the source at line boundaries and scans the pieces on up to that many threads
+    static std::vector<Token> scan_parallel(std::string_view, const unsigned);
 };
 
 };
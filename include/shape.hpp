@@ -0,0 +1,61 @@
+#ifndef SHAPE_HPP
+#define SHAPE_HPP
+
+#include "value.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace lox {
+
+// the layout of an instance's fields. instances that got the same fields in the same order share one shape, so where
+// a field lives can be remembered per shape instead of looked up by name on every access. shapes form a tree of
+// transitions from the empty root and are never freed
+class Shape {
+
+    SymbolMap<uint32_t>               slots;
+    SymbolMap<std::unique_ptr<Shape>> transitions;
+
+    Shape() = default;
+
+public:
+    static Shape* root();
+
+    int    lookup(const LoxString*) const; // -1 when the field is missing
+    Shape* add(LoxString*);                // the shape with one more field, stored right after the existing ones
+
+    size_t size() const {
+        return slots.size();
+    }
+};
+
+// remembers the shapes a property access site has seen. `from` is the instance's shape before the access and `to` the
+// one after, they only differ when an assignment added the field
+struct InlineCache {
+    static constexpr int ENTRIES = 4; // sites that see more shapes than this stay on the slow path
+
+    struct Entry {
+        const Shape* from;
+        Shape*       to;
+        uint32_t     slot;
+    };
+
+    Entry   entries[ENTRIES];
+    uint8_t count = 0;
+
+    const Entry* find(const Shape* shape) const {
+        for (int i = 0; i < count; i++)
+            if (entries[i].from == shape)
+                return &entries[i];
+        return nullptr;
+    }
+
+    void add(const Shape* from, Shape* to, const uint32_t slot) {
+        if (count < ENTRIES)
+            entries[count++] = {from, to, slot};
+    }
+};
+
+};
+
+#endif
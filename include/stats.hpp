@@ -0,0 +1,21 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <cstddef>
+
+namespace lox {
+
+// counters for --stats that do not belong to the heap, bumped where the counted thing happens
+struct RuntimeStats {
+    size_t binds   = 0; // bound methods created
+    size_t returns = 0; // return statements executed by the tree walker
+};
+
+inline RuntimeStats& runtime_stats() {
+    static RuntimeStats stats;
+    return stats;
+}
+
+};
+
+#endif
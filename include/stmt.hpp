@@ -28,11 +28,17 @@ struct StmtVisitor {
 };
 
 struct Stmt {
+    unsigned line = 0; // of the statement's first token, set by the parser
+
+    virtual ~Stmt() = default;
+
     virtual void accept(StmtVisitor&) = 0;
 };
 
 struct BlockStmt : Stmt {
     std::vector<std::unique_ptr<Stmt>> statements;
+    size_t                             slots  = 0;     // locals declared directly in the block, set by the resolver
+    bool                               framed = false; // makes no environment, its locals (if any) live in the function's frame
 
     BlockStmt(std::vector<std::unique_ptr<Stmt>> statements) : statements(std::move(statements)) {}
 
@@ -68,6 +74,8 @@ struct FnStmt : Stmt {
     Token                              name;
     std::vector<Token>                 params;
     std::vector<std::unique_ptr<Stmt>> body;
+    size_t                             slots  = 0;     // parameters plus locals declared directly in the body
+    bool                               framed = false; // no closure can capture its locals, slots is then the frame size
 
     FnStmt(Token name, std::vector<Token> params, std::vector<std::unique_ptr<Stmt>> body)
         : name(std::move(name)), params(std::move(params)), body(std::move(body)) {}
@@ -114,6 +122,7 @@ struct ReturnStmt : Stmt {
 struct VarStmt : Stmt {
     Token                 name;
     std::unique_ptr<Expr> initializer;
+    Local                 local; // a frame slot when the variable lives in one, otherwise it is defined in the current scope
 
     VarStmt(Token name, std::unique_ptr<Expr> initializer) : name(std::move(name)), initializer(std::move(initializer)) {}
 
@@ -1,11 +1,13 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
+#include "value.hpp"
+
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <variant>
 
 namespace lox {
 
@@ -15,6 +17,9 @@ enum TokenType {
     RIGHT_PAREN,
     LEFT_CURLY,
     RIGHT_CURLY,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
+    COLON,
     COMMA,
     DOT,
     MINUS,
@@ -57,42 +62,21 @@ enum TokenType {
 };
 
 const std::string tokentypes[] = {
-    "(",   ")",     "{",   "}",    ",",     ".",     "-",      "+",      ";",          "*",   "/",     "!",   "!=",
-    "=",   "==",    ">",   ">=",   "<",     "<=",    "string", "number", "identifier", "and", "or",    "if",  "else",
-    "for", "while", "nil", "true", "false", "print", "return", "super",  "this",       "var", "class", "fun",
-};
-
-static std::unordered_map<std::string, TokenType> keywords = {
-    {   "and",    AND},
-    {    "or",     OR},
-    {    "if",     IF},
-    {  "else",   ELSE},
-    {   "for",    FOR},
-    { "while",  WHILE},
-    {   "nil",    NIL},
-    {  "true",   TRUE},
-    { "false",  FALSE},
-    { "print",  PRINT},
-    {"return", RETURN},
-    { "super",  SUPER},
-    {  "this",   THIS},
-    {   "var",    VAR},
-    { "class",  CLASS},
-    {   "fun",    FUN},
+    "(",     ")",   "{",    "}",   "[",     "]",   ":",    ",",     ".",     "-",      "+",      ";",          "*",
+    "/",     "!",   "!=",   "=",   "==",    ">",   ">=",   "<",     "<=",    "string", "number", "identifier", "and",
+    "or",    "if",  "else", "for", "while", "nil", "true", "false", "print", "return", "super",  "this",       "var",
+    "class", "fun",
 };
 
-struct LoxCallable;
-struct LoxInstance;
-
-using Value = std::variant<std::monostate, bool, double, std::string, std::shared_ptr<LoxCallable>, std::shared_ptr<LoxInstance>>;
-
+// the lexeme points into the source buffer, which is kept alive for as long as any tree built from it
 struct Token {
-    const TokenType   type;
-    const std::string lexeme;
-    const Value       literal;
-    const unsigned    line;
-    Token(const TokenType type, std::string lexeme, Value literal, const unsigned line)
-        : type(type), lexeme(std::move(lexeme)), literal(std::move(literal)), line(line) {}
+    const TokenType        type;
+    const std::string_view lexeme;
+    const Value            literal;
+    const unsigned         line;
+    const Ref<LoxString>   symbol; // interned lexeme, identifiers only
+    Token(const TokenType type, std::string_view lexeme, Value literal, const unsigned line, Ref<LoxString> symbol = nullptr)
+        : type(type), lexeme(lexeme), literal(std::move(literal)), line(line), symbol(std::move(symbol)) {}
     std::string          to_string() const;
     friend std::ostream& operator<<(std::ostream&, const Token&);
 };
@@ -0,0 +1,254 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include "object.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#ifdef LOX_NAN_BOXING
+#include <bit>
+#else
+#include <variant>
+#endif
+
+namespace lox {
+
+// strings are interned, equal contents always share one object so comparing strings compares addresses
+struct LoxString : Object {
+    const std::string chars;
+    const size_t      hash;
+
+    static Ref<LoxString> intern(std::string_view);
+    ~LoxString() override;
+
+private:
+    LoxString(std::string_view chars, const size_t hash) : Object(ObjectType::STRING), chars(chars), hash(hash) {}
+};
+
+// interned strings used as keys reuse their precomputed hash, lookups may pass a raw pointer
+struct SymbolHash {
+    using is_transparent = void;
+    size_t operator()(const LoxString* symbol) const {
+        return symbol->hash;
+    }
+    size_t operator()(const Ref<LoxString>& symbol) const {
+        return symbol->hash;
+    }
+};
+
+struct SymbolEqual {
+    using is_transparent = void;
+    static const LoxString* address(const LoxString* symbol) {
+        return symbol;
+    }
+    static const LoxString* address(const Ref<LoxString>& symbol) {
+        return symbol.get();
+    }
+    template <class L, class R> bool operator()(const L& l, const R& r) const {
+        return address(l) == address(r);
+    }
+};
+
+template <class T> using SymbolMap = std::unordered_map<Ref<LoxString>, T, SymbolHash, SymbolEqual>;
+
+// nil, a boolean, a number or a pointer to an object. by default the four cases live in a std::variant, building with
+// LOX_NAN_BOXING packs them into the unused bits of a quiet NaN instead so every value is 8 bytes
+class Value {
+
+#ifdef LOX_NAN_BOXING
+    static_assert(sizeof(void*) == 8, "nan boxing needs 64 bit pointers");
+
+    static constexpr uint64_t SIGN_BIT = 0x8000000000000000;
+    static constexpr uint64_t QNAN     = 0x7ffc000000000000;
+    static constexpr uint64_t NIL      = QNAN | 1;
+    static constexpr uint64_t FALSE    = QNAN | 2;
+    static constexpr uint64_t TRUE     = QNAN | 3;
+    static constexpr uint64_t OBJECT   = SIGN_BIT | QNAN;
+
+    uint64_t bits = NIL;
+
+    static void retain(const uint64_t bits) {
+        if ((bits & OBJECT) == OBJECT)
+            reinterpret_cast<Object*>(bits & ~OBJECT)->refs++;
+    }
+
+    static void release(const uint64_t bits) {
+        if ((bits & OBJECT) == OBJECT)
+            if (Object* object = reinterpret_cast<Object*>(bits & ~OBJECT); --object->refs == 0)
+                delete object;
+    }
+
+public:
+    Value() = default;
+    Value(const bool boolean) : bits(boolean ? TRUE : FALSE) {}
+    Value(const double number) : bits(std::bit_cast<uint64_t>(number)) {}
+    template <class T> Value(Ref<T> object) {
+        if (object)
+            bits = OBJECT | reinterpret_cast<uint64_t>(static_cast<Object*>(object.detach()));
+    }
+
+    Value(const Value& other) : bits(other.bits) {
+        retain(bits);
+    }
+    Value(Value&& other) noexcept : bits(std::exchange(other.bits, NIL)) {}
+
+    // the old value is released last, its destructor may well own the other value
+    Value& operator=(const Value& other) {
+        const uint64_t old = bits;
+        bits               = other.bits;
+        retain(bits);
+        release(old);
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept {
+        const uint64_t old = bits;
+        bits               = std::exchange(other.bits, NIL);
+        release(old);
+        return *this;
+    }
+
+    ~Value() {
+        release(bits);
+    }
+
+    bool is_nil() const {
+        return bits == NIL;
+    }
+
+    bool is_bool() const {
+        return (bits | 1) == TRUE;
+    }
+
+    bool is_number() const {
+        return (bits & QNAN) != QNAN;
+    }
+
+    bool is_object() const {
+        return (bits & OBJECT) == OBJECT;
+    }
+
+    bool as_bool() const {
+        return bits == TRUE;
+    }
+
+    double as_number() const {
+        return std::bit_cast<double>(bits);
+    }
+
+    Object* as_object() const {
+        return reinterpret_cast<Object*>(bits & ~OBJECT);
+    }
+
+    friend bool operator==(const Value& l, const Value& r) {
+        if (l.is_number() and r.is_number())
+            return l.as_number() == r.as_number();
+        return l.bits == r.bits;
+    }
+#else
+    std::variant<std::monostate, bool, double, Ref<Object>> data;
+
+public:
+    Value() = default;
+    Value(const bool boolean) : data(boolean) {}
+    Value(const double number) : data(number) {}
+    template <class T> Value(Ref<T> object) {
+        if (object)
+            data = Ref<Object>(std::move(object));
+    }
+
+    bool is_nil() const {
+        return std::holds_alternative<std::monostate>(data);
+    }
+
+    bool is_bool() const {
+        return std::holds_alternative<bool>(data);
+    }
+
+    bool is_number() const {
+        return std::holds_alternative<double>(data);
+    }
+
+    bool is_object() const {
+        return std::holds_alternative<Ref<Object>>(data);
+    }
+
+    bool as_bool() const {
+        return *std::get_if<bool>(&data);
+    }
+
+    double as_number() const {
+        return *std::get_if<double>(&data);
+    }
+
+    Object* as_object() const {
+        return std::get_if<Ref<Object>>(&data)->get();
+    }
+
+    friend bool operator==(const Value& l, const Value& r) {
+        return l.data == r.data;
+    }
+#endif
+
+    Value(const std::string& chars) : Value(LoxString::intern(chars)) {}
+    Value(std::string_view chars) : Value(LoxString::intern(chars)) {}
+    Value(const char* chars) : Value(LoxString::intern(chars)) {}
+
+    bool is_string() const {
+        return is_object() and as_object()->type == ObjectType::STRING;
+    }
+
+    bool is_instance() const {
+        return is_object() and as_object()->type == ObjectType::INSTANCE;
+    }
+
+    bool is_list() const {
+        return is_object() and as_object()->type == ObjectType::LIST;
+    }
+
+    bool is_map() const {
+        return is_object() and as_object()->type == ObjectType::MAP;
+    }
+
+    bool is_callable() const {
+        return is_object() and as_object()->type >= ObjectType::NATIVE;
+    }
+
+    const std::string& as_string() const {
+        return static_cast<LoxString*>(as_object())->chars;
+    }
+
+    // the caller has already checked the object type
+    template <class T> T* as() const {
+        return static_cast<T*>(as_object());
+    }
+};
+
+// handed to Object::trace, reports each reference to the collector
+class Tracer {
+
+public:
+    virtual void visit(Object*) = 0;
+
+    void operator()(Object* object) {
+        if (object and object->traced())
+            visit(object);
+    }
+
+    void operator()(const Value& value) {
+        if (value.is_object())
+            (*this)(value.as_object());
+    }
+
+    template <class T> void operator()(const Ref<T>& object) {
+        (*this)(static_cast<Object*>(object.get()));
+    }
+};
+
+};
+
+#endif
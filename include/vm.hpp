@@ -0,0 +1,77 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include "chunk.hpp"
+#include "error.hpp"
+#include "interpreter.hpp"
+#include "lox_class.hpp"
+#include "vm_closure.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+
+class VM {
+
+    struct CallFrame {
+        VmClosure*     closure;
+        const uint8_t* ip;
+        Value*         slots;
+    };
+
+    struct Global {
+        Value value;
+        bool  defined = false;
+    };
+
+    static constexpr size_t FRAMES_MAX     = 4096;
+    static constexpr size_t STACK_MAX      = 65536;
+    static constexpr size_t STACK_HEADROOM = 512; // room every frame may use for locals and temporaries
+
+    Interpreter& interpreter;
+
+    std::unique_ptr<CallFrame[]> frames = std::make_unique<CallFrame[]>(FRAMES_MAX);
+    size_t                       frame_count = 0;
+
+    std::unique_ptr<Value[]> stack     = std::make_unique<Value[]>(STACK_MAX);
+    Value*                   stack_top = stack.get();
+
+    Ref<Upvalue> open_upvalues;
+
+    std::vector<Global>                       globals;
+    std::vector<std::string>                  global_names;
+    std::unordered_map<std::string, uint16_t> global_slots;
+
+    void  push(Value);
+    Value pop();
+    void  unwind(Value*);
+
+    unsigned     line(const size_t = 1) const;
+    RuntimeError error(const std::string&) const;
+    RuntimeError property_error(const std::string&) const;
+
+    void call_closure(VmClosure*, const size_t);
+    void call_value(const Value&, const size_t);
+    void invoke(const LoxString*, const size_t);
+    void invoke_builtin(const LoxString*, const size_t);
+    bool invoke_from_class(LoxClass&, const LoxString*, const size_t);
+
+    Ref<Upvalue> capture_upvalue(Value*);
+    void         close_upvalues(Value*);
+
+    Value run(const size_t);
+
+public:
+    VM(Interpreter&);
+
+    void     interpret(std::shared_ptr<Prototype>);
+    Value    call(VmClosure&, Value, Arguments);
+    uint16_t global_slot(std::string_view);
+};
+
+};
+
+#endif
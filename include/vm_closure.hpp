@@ -0,0 +1,60 @@
+#ifndef VM_CLOSURE_HPP
+#define VM_CLOSURE_HPP
+
+#include "chunk.hpp"
+#include "lox_callable.hpp"
+
+namespace lox {
+
+class VM;
+
+// a captured variable, pointing into the vm stack while open and at `closed` once the slot is popped
+struct Upvalue : Object {
+    Value*       location;
+    Value        closed;
+    Ref<Upvalue> next; // open upvalues are kept sorted by stack slot
+
+    Upvalue(Value* location) : Object(ObjectType::UPVALUE), location(location) {}
+
+    void trace(Tracer&) override;
+    void clear() override;
+};
+
+class VmClosure : public LoxCallable {
+
+public:
+    VM&                        vm;
+    std::shared_ptr<Prototype> function;
+    std::vector<Ref<Upvalue>>  upvalues;
+
+    VmClosure(VM& vm, std::shared_ptr<Prototype> function) : LoxCallable(ObjectType::CLOSURE), vm(vm), function(std::move(function)) {
+        upvalues.resize(this->function->upvalue_count);
+    }
+
+    void             trace(Tracer&) override;
+    void             clear() override;
+    size_t           arity() override;
+    Ref<LoxCallable> bind(Ref<LoxInstance>) override;
+    Value            call_method(Interpreter&, const Value&, Arguments) override;
+    Value            call(Interpreter&, Arguments) override;
+    std::string      to_string() const override;
+};
+
+class VmBoundMethod : public LoxCallable {
+
+public:
+    Value          receiver;
+    Ref<VmClosure> method;
+
+    VmBoundMethod(Value receiver, Ref<VmClosure> method) : LoxCallable(ObjectType::BOUND_METHOD), receiver(std::move(receiver)), method(std::move(method)) {}
+
+    void        trace(Tracer&) override;
+    void        clear() override;
+    size_t      arity() override;
+    Value       call(Interpreter&, Arguments) override;
+    std::string to_string() const override;
+};
+
+};
+
+#endif
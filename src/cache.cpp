@@ -0,0 +1,764 @@
+#include "cache.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include <unistd.h>
+
+namespace {
+
+// bumped whenever the tree or the encoding below changes
+constexpr uint32_t CACHE_VERSION = 7;
+constexpr char     CACHE_MAGIC[] = {'L', 'O', 'X', 'C'};
+constexpr uint32_t NO_LEXEME     = std::numeric_limits<uint32_t>::max();
+
+enum Node : uint8_t {
+    NONE,
+    // expressions
+    ASSIGN,
+    BINARY,
+    CALL,
+    GET,
+    GROUPING,
+    INDEX,
+    INDEX_SET,
+    LIST,
+    LITERAL,
+    LOGICAL,
+    MAP,
+    SET,
+    SUPER,
+    THIS,
+    UNARY,
+    VARIABLE,
+    // statements
+    BLOCK,
+    CLASS,
+    EXPRESSION,
+    FUNCTION,
+    IF,
+    PRINT,
+    RETURN,
+    VAR,
+    WHILE,
+};
+
+enum ValueTag : uint8_t {
+    NIL_VALUE,
+    FALSE_VALUE,
+    TRUE_VALUE,
+    NUMBER_VALUE,
+    STRING_VALUE,
+};
+
+constexpr uint64_t hash(std::string_view source) {
+    uint64_t hash = 14695981039346656037ull; // fnv-1a
+    for (const char ch : source)
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+    return hash;
+}
+
+// a tree resolved by another build of the interpreter may not mean the same thing to this one. the makefile
+// recompiles this file whenever any other object changes, so the timestamp moves with every build
+constexpr uint64_t BUILD_ID = hash(__DATE__ " " __TIME__);
+
+// numbers are written in host byte order, a cache is never shared between machines
+class Writer : lox::ExprVisitor, lox::StmtVisitor {
+
+    std::string_view                               source;
+    std::unordered_map<const lox::LoxString*, int> string_ids;
+    std::vector<const lox::LoxString*>             strings;
+    std::string                                    body;
+
+    template <class T> void put(std::string& out, const T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <class T> void put(const T value) {
+        put(body, value);
+    }
+
+    void put_string(const lox::LoxString* string) {
+        auto [it, added] = string_ids.try_emplace(string, strings.size());
+        if (added)
+            strings.push_back(string);
+        put<uint32_t>(it->second);
+    }
+
+    void put_value(const lox::Value& value) {
+        if (value.is_nil())
+            put(NIL_VALUE);
+        else if (value.is_bool())
+            put(value.as_bool() ? TRUE_VALUE : FALSE_VALUE);
+        else if (value.is_number()) {
+            put(NUMBER_VALUE);
+            put(value.as_number());
+        } else {
+            put(STRING_VALUE); // the parser only ever puts strings into literals
+            put_string(value.as<lox::LoxString>());
+        }
+    }
+
+    void put_token(const lox::Token& token) {
+        put<uint8_t>(token.type);
+        put<uint32_t>(token.line);
+        if (token.lexeme.data() >= source.data() and token.lexeme.data() + token.lexeme.size() <= source.data() + source.size()) {
+            put<uint32_t>(token.lexeme.data() - source.data());
+            put<uint32_t>(token.lexeme.size());
+        } else {
+            put(NO_LEXEME);
+            put<uint32_t>(0);
+        }
+        put_value(token.literal);
+        if (token.symbol) {
+            put<uint8_t>(1);
+            put_string(token.symbol.get());
+        } else
+            put<uint8_t>(0);
+    }
+
+    void put_local(const lox::Local& local) {
+        put<int32_t>(local.depth);
+        put<int32_t>(local.slot);
+    }
+
+    void put_expr(const std::unique_ptr<lox::Expr>& expr) {
+        if (expr)
+            expr->accept(*this);
+        else
+            put(NONE);
+    }
+
+    void put_stmt(const std::unique_ptr<lox::Stmt>& stmt) {
+        if (stmt) {
+            stmt->accept(*this);
+            put<uint32_t>(stmt->line);
+        } else
+            put(NONE);
+    }
+
+    void put_block(const std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+        put<uint32_t>(statements.size());
+        for (const auto& statement : statements)
+            put_stmt(statement);
+    }
+
+    void put_function(lox::FnStmt& stmt) {
+        put(FUNCTION);
+        put_token(stmt.name);
+        put<uint32_t>(stmt.params.size());
+        for (const lox::Token& param : stmt.params)
+            put_token(param);
+        put<uint32_t>(stmt.slots);
+        put<uint8_t>(stmt.framed);
+        put_block(stmt.body);
+    }
+
+    lox::Value visit(lox::AssignExpr& expr) override {
+        put(ASSIGN);
+        put_token(expr.name);
+        put_expr(expr.value);
+        put_local(expr.local);
+        return {};
+    }
+
+    lox::Value visit(lox::BinaryExpr& expr) override {
+        put(BINARY);
+        put_expr(expr.left);
+        put_token(expr.op);
+        put_expr(expr.right);
+        return {};
+    }
+
+    lox::Value visit(lox::CallExpr& expr) override {
+        put(CALL);
+        put_expr(expr.callee);
+        put_token(expr.paren);
+        put<uint32_t>(expr.arguments.size());
+        for (const auto& argument : expr.arguments)
+            put_expr(argument);
+        return {};
+    }
+
+    lox::Value visit(lox::GetExpr& expr) override {
+        put(GET);
+        put_expr(expr.object);
+        put_token(expr.name);
+        return {};
+    }
+
+    lox::Value visit(lox::GroupingExpr& expr) override {
+        put(GROUPING);
+        put_expr(expr.expr);
+        return {};
+    }
+
+    lox::Value visit(lox::IndexExpr& expr) override {
+        put(INDEX);
+        put_expr(expr.object);
+        put_token(expr.bracket);
+        put_expr(expr.index);
+        return {};
+    }
+
+    lox::Value visit(lox::IndexSetExpr& expr) override {
+        put(INDEX_SET);
+        put_expr(expr.object);
+        put_token(expr.bracket);
+        put_expr(expr.index);
+        put_expr(expr.value);
+        return {};
+    }
+
+    lox::Value visit(lox::ListExpr& expr) override {
+        put(LIST);
+        put_token(expr.bracket);
+        put<uint32_t>(expr.elements.size());
+        for (const auto& element : expr.elements)
+            put_expr(element);
+        return {};
+    }
+
+    lox::Value visit(lox::LiteralExpr& expr) override {
+        put(LITERAL);
+        put_value(expr.value);
+        return {};
+    }
+
+    lox::Value visit(lox::LogicalExpr& expr) override {
+        put(LOGICAL);
+        put_expr(expr.left);
+        put_token(expr.op);
+        put_expr(expr.right);
+        return {};
+    }
+
+    lox::Value visit(lox::MapExpr& expr) override {
+        put(MAP);
+        put_token(expr.brace);
+        put<uint32_t>(expr.keys.size());
+        for (size_t i = 0; i < expr.keys.size(); i++) {
+            put_expr(expr.keys[i]);
+            put_expr(expr.values[i]);
+        }
+        return {};
+    }
+
+    lox::Value visit(lox::SetExpr& expr) override {
+        put(SET);
+        put_expr(expr.object);
+        put_expr(expr.value);
+        put_token(expr.name);
+        return {};
+    }
+
+    lox::Value visit(lox::SuperExpr& expr) override {
+        put(SUPER);
+        put_token(expr.keyword);
+        put_token(expr.method);
+        put_local(expr.local);
+        put_local(expr.receiver);
+        return {};
+    }
+
+    lox::Value visit(lox::ThisExpr& expr) override {
+        put(THIS);
+        put_token(expr.keyword);
+        put_local(expr.local);
+        return {};
+    }
+
+    lox::Value visit(lox::UnaryExpr& expr) override {
+        put(UNARY);
+        put_token(expr.op);
+        put_expr(expr.right);
+        return {};
+    }
+
+    lox::Value visit(lox::VariableExpr& expr) override {
+        put(VARIABLE);
+        put_token(expr.name);
+        put_local(expr.local);
+        return {};
+    }
+
+    void visit(lox::BlockStmt& stmt) override {
+        put(BLOCK);
+        put<uint32_t>(stmt.slots);
+        put<uint8_t>(stmt.framed);
+        put_block(stmt.statements);
+    }
+
+    void visit(lox::ClassStmt& stmt) override {
+        put(CLASS);
+        put_token(stmt.name);
+        if (stmt.superclass)
+            visit(*stmt.superclass);
+        else
+            put(NONE);
+        put<uint32_t>(stmt.methods.size());
+        for (const auto& method : stmt.methods)
+            put_function(*method);
+    }
+
+    void visit(lox::ExprStmt& stmt) override {
+        put(EXPRESSION);
+        put_expr(stmt.expr);
+    }
+
+    void visit(lox::FnStmt& stmt) override {
+        put_function(stmt);
+    }
+
+    void visit(lox::IfStmt& stmt) override {
+        put(IF);
+        put_expr(stmt.condition);
+        put_stmt(stmt.then);
+        put_stmt(stmt.otherwise);
+    }
+
+    void visit(lox::PrintStmt& stmt) override {
+        put(PRINT);
+        put_expr(stmt.expr);
+    }
+
+    void visit(lox::ReturnStmt& stmt) override {
+        put(RETURN);
+        put_token(stmt.keyword);
+        put_expr(stmt.value);
+    }
+
+    void visit(lox::VarStmt& stmt) override {
+        put(VAR);
+        put_token(stmt.name);
+        put_expr(stmt.initializer);
+        put_local(stmt.local);
+    }
+
+    void visit(lox::WhileStmt& stmt) override {
+        put(WHILE);
+        put_expr(stmt.condition);
+        put_stmt(stmt.body);
+    }
+
+public:
+    Writer(std::string_view source) : source(source) {}
+
+    std::string write(const std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+        put_block(statements);
+        std::string out(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        put(out, CACHE_VERSION);
+        put(out, BUILD_ID);
+        put<uint64_t>(out, source.size());
+        put(out, hash(source));
+        put<uint32_t>(out, strings.size());
+        for (const lox::LoxString* string : strings) {
+            put<uint32_t>(out, string->chars.size());
+            out += string->chars;
+        }
+        out += body;
+        put(out, hash(out)); // checksum over everything before it
+        return out;
+    }
+};
+
+struct Malformed {};
+
+// any inconsistency throws Malformed, the caller then falls back to the source
+class Reader {
+
+    std::string_view                 source;
+    const char*                      current;
+    const char*                      end;
+    std::vector<lox::Ref<lox::LoxString>> strings;
+
+    // the sizes of the environments around the node being read and of the frame it runs in, every local is checked
+    // against them so a bad slot can't index past what the engines allocate
+    std::vector<uint32_t> environments;
+    uint32_t              frame = 0; // none outside a framed function
+
+    template <class T> T get() {
+        if (static_cast<size_t>(end - current) < sizeof(T))
+            throw Malformed{};
+        T value;
+        std::memcpy(&value, current, sizeof(T));
+        current += sizeof(T);
+        return value;
+    }
+
+    // every element that is counted takes at least a byte, so a count can't be larger than what is left
+    uint32_t get_count() {
+        const uint32_t count = get<uint32_t>();
+        if (count > static_cast<size_t>(end - current))
+            throw Malformed{};
+        return count;
+    }
+
+    lox::Ref<lox::LoxString> get_string() {
+        const uint32_t id = get<uint32_t>();
+        if (id >= strings.size())
+            throw Malformed{};
+        return strings[id];
+    }
+
+    lox::Value get_value() {
+        switch (get<ValueTag>()) {
+        case NIL_VALUE:
+            return {};
+        case FALSE_VALUE:
+            return false;
+        case TRUE_VALUE:
+            return true;
+        case NUMBER_VALUE:
+            return get<double>();
+        case STRING_VALUE:
+            return get_string();
+        }
+        throw Malformed{};
+    }
+
+    lox::Token get_token() {
+        const uint8_t  type   = get<uint8_t>();
+        const uint32_t line   = get<uint32_t>();
+        const uint32_t offset = get<uint32_t>();
+        const uint32_t length = get<uint32_t>();
+        if (type > lox::END or (offset != NO_LEXEME and (offset > source.size() or length > source.size() - offset)))
+            throw Malformed{};
+        std::string_view lexeme = offset == NO_LEXEME ? std::string_view() : source.substr(offset, length);
+        lox::Value       value  = get_value();
+        if (get<uint8_t>())
+            return lox::Token(static_cast<lox::TokenType>(type), lexeme, std::move(value), line, get_string());
+        return lox::Token(static_cast<lox::TokenType>(type), lexeme, std::move(value), line);
+    }
+
+    lox::Local get_local() {
+        lox::Local local;
+        local.depth = get<int32_t>();
+        local.slot  = get<int32_t>();
+        if (local.is_global())
+            return local;
+        if (local.slot < 0)
+            throw Malformed{};
+        if (local.is_frame()) {
+            if (static_cast<uint32_t>(local.slot) >= frame)
+                throw Malformed{};
+        } else if (local.depth < 0 or static_cast<size_t>(local.depth) >= environments.size()
+                   or static_cast<uint32_t>(local.slot) >= environments[environments.size() - 1 - local.depth])
+            throw Malformed{};
+        return local;
+    }
+
+    template <class T> std::unique_ptr<T> get_as(std::unique_ptr<lox::Expr> expr) {
+        if (expr and !dynamic_cast<T*>(expr.get()))
+            throw Malformed{};
+        return std::unique_ptr<T>(static_cast<T*>(expr.release()));
+    }
+
+    std::unique_ptr<lox::Expr> get_expr() {
+        switch (get<Node>()) {
+        case NONE:
+            return nullptr;
+        case ASSIGN: {
+            lox::Token name  = get_token();
+            auto       value = get_expr();
+            auto       expr  = std::make_unique<lox::AssignExpr>(std::move(name), std::move(value));
+            expr->local      = get_local();
+            return expr;
+        }
+        case BINARY: {
+            auto       left  = get_expr();
+            lox::Token op    = get_token();
+            auto       right = get_expr();
+            return std::make_unique<lox::BinaryExpr>(std::move(left), std::move(op), std::move(right));
+        }
+        case CALL: {
+            auto                                    callee = get_expr();
+            lox::Token                              paren  = get_token();
+            std::vector<std::unique_ptr<lox::Expr>> arguments(get_count());
+            for (auto& argument : arguments)
+                argument = get_expr();
+            lox::GetExpr*   method = dynamic_cast<lox::GetExpr*>(callee.get());
+            lox::SuperExpr* super  = dynamic_cast<lox::SuperExpr*>(callee.get());
+            return std::make_unique<lox::CallExpr>(std::move(callee), std::move(paren), std::move(arguments), method, super);
+        }
+        case GET: {
+            auto       object = get_expr();
+            lox::Token name   = get_token();
+            return std::make_unique<lox::GetExpr>(std::move(object), std::move(name));
+        }
+        case GROUPING:
+            return std::make_unique<lox::GroupingExpr>(get_expr());
+        case INDEX: {
+            auto       object  = get_expr();
+            lox::Token bracket = get_token();
+            auto       index   = get_expr();
+            return std::make_unique<lox::IndexExpr>(std::move(object), std::move(bracket), std::move(index));
+        }
+        case INDEX_SET: {
+            auto       object  = get_expr();
+            lox::Token bracket = get_token();
+            auto       index   = get_expr();
+            auto       value   = get_expr();
+            return std::make_unique<lox::IndexSetExpr>(std::move(object), std::move(bracket), std::move(index), std::move(value));
+        }
+        case LIST: {
+            lox::Token                              bracket = get_token();
+            std::vector<std::unique_ptr<lox::Expr>> elements(get_count());
+            for (auto& element : elements)
+                element = get_expr();
+            return std::make_unique<lox::ListExpr>(std::move(bracket), std::move(elements));
+        }
+        case LITERAL:
+            return std::make_unique<lox::LiteralExpr>(get_value());
+        case LOGICAL: {
+            auto       left  = get_expr();
+            lox::Token op    = get_token();
+            auto       right = get_expr();
+            return std::make_unique<lox::LogicalExpr>(std::move(left), std::move(op), std::move(right));
+        }
+        case MAP: {
+            lox::Token                              brace = get_token();
+            std::vector<std::unique_ptr<lox::Expr>> keys(get_count());
+            std::vector<std::unique_ptr<lox::Expr>> values(keys.size());
+            for (size_t i = 0; i < keys.size(); i++) {
+                keys[i]   = get_expr();
+                values[i] = get_expr();
+            }
+            return std::make_unique<lox::MapExpr>(std::move(brace), std::move(keys), std::move(values));
+        }
+        case SET: {
+            auto       object = get_expr();
+            auto       value  = get_expr();
+            lox::Token name   = get_token();
+            return std::make_unique<lox::SetExpr>(std::move(object), std::move(value), std::move(name));
+        }
+        case SUPER: {
+            lox::Token keyword = get_token();
+            lox::Token method  = get_token();
+            auto       expr    = std::make_unique<lox::SuperExpr>(std::move(keyword), std::move(method));
+            expr->local        = get_local();
+            expr->receiver     = get_local();
+            return expr;
+        }
+        case THIS: {
+            auto expr   = std::make_unique<lox::ThisExpr>(get_token());
+            expr->local = get_local();
+            return expr;
+        }
+        case UNARY: {
+            lox::Token op = get_token();
+            return std::make_unique<lox::UnaryExpr>(std::move(op), get_expr());
+        }
+        case VARIABLE: {
+            auto expr   = std::make_unique<lox::VariableExpr>(get_token());
+            expr->local = get_local();
+            return expr;
+        }
+        default:
+            break;
+        }
+        throw Malformed{};
+    }
+
+    std::unique_ptr<lox::FnStmt> get_function() {
+        lox::Token              name = get_token();
+        std::vector<lox::Token> params;
+        for (uint32_t count = get_count(); count > 0; count--)
+            params.push_back(get_token());
+        const uint32_t slots  = get<uint32_t>(); // the receiver, the parameters and what the body declares
+        const bool     framed = get<uint8_t>();
+        if (slots < params.size() or slots - params.size() > 1 + static_cast<size_t>(end - current))
+            throw Malformed{};
+        // the body runs either in a frame of its own or in one more environment
+        const uint32_t enclosing = std::exchange(frame, framed ? slots : 0);
+        if (!framed)
+            environments.push_back(slots);
+        auto body = get_block();
+        if (!framed)
+            environments.pop_back();
+        frame            = enclosing;
+        auto function    = std::make_unique<lox::FnStmt>(std::move(name), std::move(params), std::move(body));
+        function->slots  = slots;
+        function->framed = framed;
+        function->line   = function->name.line;
+        return function;
+    }
+
+    std::vector<std::unique_ptr<lox::Stmt>> get_block() {
+        std::vector<std::unique_ptr<lox::Stmt>> statements(get_count());
+        for (auto& statement : statements)
+            if (!(statement = get_stmt()))
+                throw Malformed{};
+        return statements;
+    }
+
+    std::unique_ptr<lox::Stmt> get_stmt() {
+        std::unique_ptr<lox::Stmt> stmt = get_node();
+        if (stmt)
+            stmt->line = get<uint32_t>();
+        return stmt;
+    }
+
+    std::unique_ptr<lox::Stmt> get_node() {
+        switch (get<Node>()) {
+        case NONE:
+            return nullptr;
+        case BLOCK: {
+            const uint32_t slots  = get_count();
+            const bool     framed = get<uint8_t>();
+            if (!framed)
+                environments.push_back(slots);
+            auto block = std::make_unique<lox::BlockStmt>(get_block());
+            if (!framed)
+                environments.pop_back();
+            block->slots  = slots;
+            block->framed = framed;
+            return block;
+        }
+        case CLASS: {
+            lox::Token name       = get_token();
+            auto       superclass = get_as<lox::VariableExpr>(get_expr());
+            if (superclass)
+                environments.push_back(1); // super
+            std::vector<std::unique_ptr<lox::FnStmt>> methods(get_count());
+            for (auto& method : methods) {
+                if (get<Node>() != FUNCTION)
+                    throw Malformed{};
+                method = get_function();
+            }
+            if (superclass)
+                environments.pop_back();
+            return std::make_unique<lox::ClassStmt>(std::move(name), std::move(methods), std::move(superclass));
+        }
+        case EXPRESSION:
+            return std::make_unique<lox::ExprStmt>(get_expr());
+        case FUNCTION:
+            return get_function();
+        case IF: {
+            auto condition = get_expr();
+            auto then      = get_stmt();
+            auto otherwise = get_stmt();
+            return std::make_unique<lox::IfStmt>(std::move(condition), std::move(then), std::move(otherwise));
+        }
+        case PRINT:
+            return std::make_unique<lox::PrintStmt>(get_expr());
+        case RETURN: {
+            lox::Token keyword = get_token();
+            return std::make_unique<lox::ReturnStmt>(std::move(keyword), get_expr());
+        }
+        case VAR: {
+            lox::Token name = get_token();
+            auto       stmt = std::make_unique<lox::VarStmt>(std::move(name), get_expr());
+            stmt->local     = get_local();
+            return stmt;
+        }
+        case WHILE: {
+            auto condition = get_expr();
+            return std::make_unique<lox::WhileStmt>(std::move(condition), get_stmt());
+        }
+        default:
+            break;
+        }
+        throw Malformed{};
+    }
+
+public:
+    Reader(std::string_view source, std::string_view data) : source(source), current(data.data()), end(data.data() + data.size()) {}
+
+    std::vector<std::unique_ptr<lox::Stmt>> read() {
+        uint64_t checksum;
+        if (static_cast<size_t>(end - current) < sizeof(checksum))
+            throw Malformed{};
+        end -= sizeof(checksum);
+        std::memcpy(&checksum, end, sizeof(checksum));
+        if (checksum != hash(std::string_view(current, end - current)))
+            throw Malformed{};
+        char magic[sizeof(CACHE_MAGIC)];
+        for (char& ch : magic)
+            ch = get<char>();
+        if (std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 or get<uint32_t>() != CACHE_VERSION or get<uint64_t>() != BUILD_ID
+            or get<uint64_t>() != source.size() or get<uint64_t>() != hash(source))
+            throw Malformed{};
+        strings.resize(get_count());
+        for (auto& string : strings) {
+            const uint32_t length = get<uint32_t>();
+            if (static_cast<size_t>(end - current) < length)
+                throw Malformed{};
+            string = lox::LoxString::intern(std::string_view(current, length));
+            current += length;
+        }
+        std::vector<std::unique_ptr<lox::Stmt>> statements = get_block();
+        if (current != end)
+            throw Malformed{};
+        return statements;
+    }
+};
+
+};
+
+std::string lox::cache_path(const std::string& script) {
+    std::filesystem::path directory;
+    if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache and *cache == '/') // relative paths are to be ignored
+        directory = cache;
+    else if (const char* home = std::getenv("HOME"); home and *home)
+        directory = std::filesystem::path(home) / ".cache";
+    else
+        return {};
+    std::error_code error;
+    const std::filesystem::path absolute = std::filesystem::absolute(script, error);
+    if (error)
+        return {};
+    char name[sizeof("0123456789abcdef.loxc")];
+    std::snprintf(name, sizeof(name), "%016llx.loxc", static_cast<unsigned long long>(hash(absolute.lexically_normal().string())));
+    return (directory / "lox" / name).string();
+}
+
+bool lox::load_cache(const std::string& path, std::string_view source, std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+    const std::string data = std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    try {
+        statements = Reader(source, data).read();
+        return true;
+    } catch (Malformed) {
+        return false;
+    }
+}
+
+void lox::save_cache(const std::string& path, std::string_view source, const std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    if (source.size() >= NO_LEXEME)
+        return;
+    const std::string data = Writer(source).write(statements);
+    std::error_code   error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    if (error)
+        return;
+    // written next to the cache and renamed into place, so a reader never sees half a cache. mkstemp creates a file
+    // of its own under a fresh name, it never opens one that is already there or follows a link planted in its place
+    std::string temporary = path + ".XXXXXX";
+    const int   fd        = mkstemp(temporary.data());
+    if (fd == -1)
+        return;
+    bool written = true;
+    for (size_t done = 0; written and done < data.size();) {
+        const ssize_t count = write(fd, data.data() + done, data.size() - done);
+        if (count > 0)
+            done += count;
+        else if (count == 0 or errno != EINTR)
+            written = false;
+    }
+    if (close(fd) != 0)
+        written = false;
+    if (!written or std::rename(temporary.c_str(), path.c_str()) != 0)
+        unlink(temporary.c_str());
+}
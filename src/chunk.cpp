@@ -0,0 +1,21 @@
+#include "chunk.hpp"
+
+void lox::Chunk::write(const uint8_t byte, const unsigned line) {
+    code.push_back(byte);
+    lines.push_back(line);
+}
+
+size_t lox::Chunk::add_constant(lox::Value value) {
+    constants.emplace_back(std::move(value));
+    return constants.size() - 1;
+}
+
+size_t lox::Chunk::add_cache() {
+    caches.emplace_back();
+    return caches.size() - 1;
+}
+
+size_t lox::Chunk::add_function(std::shared_ptr<lox::Prototype> function) {
+    functions.emplace_back(std::move(function));
+    return functions.size() - 1;
+}
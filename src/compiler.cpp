@@ -0,0 +1,527 @@
+#include "compiler.hpp"
+
+#include "error.hpp"
+
+#include <algorithm>
+#include <limits>
+
+lox::Chunk& lox::Compiler::chunk() {
+    return current->function->chunk;
+}
+
+void lox::Compiler::emit(const uint8_t byte) {
+    chunk().write(byte, line);
+}
+
+void lox::Compiler::emit(const uint8_t op, const uint8_t operand) {
+    emit(op);
+    emit(operand);
+}
+
+void lox::Compiler::emit_short(const uint8_t op, const uint16_t operand) {
+    emit(op);
+    emit(operand >> 8);
+    emit(operand & 0xff);
+}
+
+size_t lox::Compiler::emit_jump(const uint8_t op) {
+    emit_short(op, 0xffff);
+    return chunk().code.size() - 2;
+}
+
+void lox::Compiler::patch_jump(const size_t offset) {
+    const size_t jump = chunk().code.size() - offset - 2;
+    if (jump > std::numeric_limits<uint16_t>::max())
+        error("Too much code to jump over", line);
+    chunk().code[offset]     = (jump >> 8) & 0xff;
+    chunk().code[offset + 1] = jump & 0xff;
+}
+
+void lox::Compiler::emit_loop(const size_t start) {
+    const size_t offset = chunk().code.size() - start + 3;
+    if (offset > std::numeric_limits<uint16_t>::max())
+        error("Loop body too large", line);
+    emit_short(OP_LOOP, offset);
+}
+
+void lox::Compiler::emit_return() {
+    if (current->type == FunctionType::INITIALIZER)
+        emit(OP_GET_LOCAL, 0);
+    else
+        emit(OP_NIL);
+    emit(OP_RETURN);
+}
+
+void lox::Compiler::emit_property(const uint8_t op, std::string_view name) {
+    emit_short(op, identifier_constant(name));
+    const size_t cache = chunk().add_cache();
+    if (cache > std::numeric_limits<uint16_t>::max())
+        error("Too many property accesses in one chunk", line);
+    emit(cache >> 8);
+    emit(cache & 0xff);
+}
+
+void lox::Compiler::emit_constant(lox::Value value) {
+    emit_short(OP_CONSTANT, make_constant(std::move(value)));
+}
+
+uint16_t lox::Compiler::make_constant(lox::Value value) {
+    const size_t constant = chunk().add_constant(std::move(value));
+    if (constant > std::numeric_limits<uint16_t>::max()) {
+        error("Too many constants in one chunk", line);
+        return 0;
+    }
+    return constant;
+}
+
+uint16_t lox::Compiler::identifier_constant(std::string_view name) {
+    if (auto it = current->names.find(name); it != current->names.end())
+        return it->second;
+    const uint16_t constant = make_constant(name);
+    current->names[name]    = constant;
+    return constant;
+}
+
+void lox::Compiler::begin_scope() {
+    current->scope_depth++;
+}
+
+void lox::Compiler::end_scope() {
+    current->scope_depth--;
+    std::vector<Local>& locals = current->locals;
+    while (!locals.empty() and locals.back().depth > current->scope_depth) {
+        emit(locals.back().captured ? OP_CLOSE_UPVALUE : OP_POP);
+        locals.pop_back();
+        if (current->framed)
+            current->frame.pop_back(); // the resolver hands out the slots of a finished block again as well
+    }
+}
+
+// the new local takes the next slot of the frame or of the innermost environment, just like in the resolver
+int lox::Compiler::add_local() {
+    if (current->locals.size() == 256)
+        error("Too many local variables in function", line); // still tracked so the scopes stay in step
+    const uint8_t index = current->locals.size();
+    current->locals.push_back({current->scope_depth, false});
+    (current->framed ? current->frame : scopes.back().slots).push_back(index);
+    return index;
+}
+
+int lox::Compiler::resolve_upvalue(FunctionState& state, FunctionState& owner, const uint8_t index) {
+    if (state.enclosing == &owner) {
+        owner.locals[index].captured = true;
+        return add_upvalue(state, index, true);
+    }
+    return add_upvalue(state, resolve_upvalue(*state.enclosing, owner, index), false);
+}
+
+int lox::Compiler::add_upvalue(FunctionState& state, const uint8_t index, const bool is_local) {
+    for (size_t i = 0; i < state.upvalues.size(); i++)
+        if (state.upvalues[i].index == index and state.upvalues[i].is_local == is_local)
+            return i;
+    if (state.upvalues.size() == 256) {
+        error("Too many closure variables in function", line);
+        return 0;
+    }
+    state.upvalues.push_back({index, is_local});
+    return state.upvalues.size() - 1;
+}
+
+// the function that owns the local a resolved variable lives in, and its index there
+std::pair<lox::Compiler::FunctionState*, uint8_t> lox::Compiler::locate(const lox::Local& local) {
+    if (local.is_frame())
+        return {current, current->frame[local.slot]};
+    const Scope& scope = scopes[scopes.size() - 1 - local.depth];
+    return {scope.function, scope.slots[local.slot]};
+}
+
+void lox::Compiler::load_variable(const lox::Local& local, std::string_view name) {
+    if (local.is_global())
+        emit_short(OP_GET_GLOBAL, vm.global_slot(name));
+    else if (auto [owner, index] = locate(local); owner == current)
+        emit(OP_GET_LOCAL, index);
+    else
+        emit(OP_GET_UPVALUE, resolve_upvalue(*current, *owner, index));
+}
+
+void lox::Compiler::store_variable(const lox::Local& local, std::string_view name) {
+    if (local.is_global())
+        emit_short(OP_SET_GLOBAL, vm.global_slot(name));
+    else if (auto [owner, index] = locate(local); owner == current)
+        emit(OP_SET_LOCAL, index);
+    else
+        emit(OP_SET_UPVALUE, resolve_upvalue(*current, *owner, index));
+}
+
+// returns the local the value went into, or -1 for a global
+int lox::Compiler::define_variable(std::string_view name) {
+    if (current->scope_depth > 0)
+        return add_local(); // the initializer already sits in the new local's slot
+    emit_short(OP_DEFINE_GLOBAL, vm.global_slot(name));
+    return -1;
+}
+
+void lox::Compiler::function(lox::FnStmt& stmt, const lox::Compiler::FunctionType type) {
+    FunctionState state(current, std::make_shared<Prototype>(std::string(stmt.name.lexeme)), type, stmt.framed);
+    state.function->arity = stmt.params.size();
+    state.locals.push_back({0, false});
+    state.scope_depth = 1;
+    current           = &state;
+    if (!stmt.framed)
+        scopes.push_back({current, {}});
+    if (type != FunctionType::FUNCTION) // the receiver is the first slot of a method's scope
+        (stmt.framed ? state.frame : scopes.back().slots).push_back(0);
+    for (size_t i = 0; i < stmt.params.size(); i++)
+        add_local();
+    for (const auto& statement : stmt.body)
+        compile(statement);
+    line = stmt.name.line;
+    emit_return();
+    if (!stmt.framed)
+        scopes.pop_back();
+    current                         = state.enclosing;
+    state.function->upvalue_count   = state.upvalues.size();
+    const size_t function           = chunk().add_function(std::move(state.function));
+    if (function > std::numeric_limits<uint16_t>::max())
+        error("Too many functions in one chunk", line);
+    emit_short(OP_CLOSURE, function);
+    for (const UpvalueRef& upvalue : state.upvalues)
+        emit(upvalue.is_local, upvalue.index);
+}
+
+void lox::Compiler::compile(const std::unique_ptr<lox::Stmt>& stmt) {
+    stmt->accept(*this);
+}
+
+void lox::Compiler::compile(const std::unique_ptr<lox::Expr>& expr) {
+    expr->accept(*this);
+}
+
+lox::Value lox::Compiler::visit(lox::AssignExpr& expr) {
+    compile(expr.value);
+    line = expr.name.line;
+    store_variable(expr.local, expr.name.lexeme);
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::BinaryExpr& expr) {
+    compile(expr.left);
+    compile(expr.right);
+    line = expr.op.line;
+    switch (expr.op.type) {
+    case BANG_EQUAL:
+        emit(OP_NOT_EQUAL);
+        break;
+    case EQUAL_EQUAL:
+        emit(OP_EQUAL);
+        break;
+    case GREATER:
+        emit(OP_GREATER);
+        break;
+    case GREATER_EQUAL:
+        emit(OP_GREATER_EQUAL);
+        break;
+    case LESSER:
+        emit(OP_LESSER);
+        break;
+    case LESSER_EQUAL:
+        emit(OP_LESSER_EQUAL);
+        break;
+    case PLUS:
+        emit(OP_ADD);
+        break;
+    case MINUS:
+        emit(OP_SUBTRACT);
+        break;
+    case STAR:
+        emit(OP_MULTIPLY);
+        break;
+    case SLASH:
+        emit(OP_DIVIDE);
+        break;
+    default:
+        break;
+    }
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::CallExpr& expr) {
+    // a method called on the spot skips the bound method. the name operand carries the line of the method name and
+    // the argument count that of the parenthesis, so lookup and call errors are reported where the tree-walker would
+    if (GetExpr* get = expr.method) {
+        compile(get->object);
+        for (const auto& argument : expr.arguments)
+            compile(argument);
+        line = get->name.line;
+        emit_short(OP_INVOKE, identifier_constant(get->name.lexeme));
+        line = expr.paren.line;
+        emit(expr.arguments.size());
+        return {};
+    }
+    if (SuperExpr* super = expr.super) {
+        line = super->keyword.line;
+        load_variable(super->receiver, "this");
+        for (const auto& argument : expr.arguments)
+            compile(argument);
+        line = super->keyword.line;
+        load_variable(super->local, "super");
+        line = super->method.line;
+        emit_short(OP_SUPER_INVOKE, identifier_constant(super->method.lexeme));
+        line = expr.paren.line;
+        emit(expr.arguments.size());
+        return {};
+    }
+    compile(expr.callee);
+    for (const auto& argument : expr.arguments)
+        compile(argument);
+    line = expr.paren.line;
+    emit(OP_CALL, expr.arguments.size());
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::GetExpr& expr) {
+    compile(expr.object);
+    line = expr.name.line;
+    emit_property(OP_GET_PROPERTY, expr.name.lexeme);
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::GroupingExpr& expr) {
+    compile(expr.expr);
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::IndexExpr& expr) {
+    compile(expr.object);
+    compile(expr.index);
+    line = expr.bracket.line;
+    emit(OP_GET_INDEX);
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::IndexSetExpr& expr) {
+    compile(expr.object);
+    compile(expr.index);
+    compile(expr.value);
+    line = expr.bracket.line;
+    emit(OP_SET_INDEX);
+    return {};
+}
+
+// the elements are appended one at a time, so a long literal never needs more than two stack slots
+lox::Value lox::Compiler::visit(lox::ListExpr& expr) {
+    line = expr.bracket.line;
+    emit_short(OP_LIST, std::min<size_t>(expr.elements.size(), std::numeric_limits<uint16_t>::max()));
+    for (const auto& element : expr.elements) {
+        compile(element);
+        line = expr.bracket.line;
+        emit(OP_APPEND);
+    }
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::LiteralExpr& expr) {
+    if (expr.value.is_nil())
+        emit(OP_NIL);
+    else if (expr.value.is_bool())
+        emit(expr.value.as_bool() ? OP_TRUE : OP_FALSE);
+    else
+        emit_constant(expr.value);
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::LogicalExpr& expr) {
+    compile(expr.left);
+    line = expr.op.line;
+    if (expr.op.type == OR) {
+        const size_t otherwise = emit_jump(OP_JUMP_IF_FALSE);
+        const size_t end       = emit_jump(OP_JUMP);
+        patch_jump(otherwise);
+        emit(OP_POP);
+        compile(expr.right);
+        patch_jump(end);
+    } else { // and branch
+        const size_t end = emit_jump(OP_JUMP_IF_FALSE);
+        emit(OP_POP);
+        compile(expr.right);
+        patch_jump(end);
+    }
+    return {};
+}
+
+// like a list, a map is filled one entry at a time
+lox::Value lox::Compiler::visit(lox::MapExpr& expr) {
+    line = expr.brace.line;
+    emit_short(OP_MAP, std::min<size_t>(expr.keys.size(), std::numeric_limits<uint16_t>::max()));
+    for (size_t i = 0; i < expr.keys.size(); i++) {
+        compile(expr.keys[i]);
+        compile(expr.values[i]);
+        line = expr.brace.line;
+        emit(OP_INSERT);
+    }
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::SetExpr& expr) {
+    compile(expr.object);
+    compile(expr.value);
+    line = expr.name.line;
+    emit_property(OP_SET_PROPERTY, expr.name.lexeme);
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::SuperExpr& expr) {
+    line = expr.keyword.line;
+    load_variable(expr.receiver, "this");
+    load_variable(expr.local, "super");
+    line = expr.method.line;
+    emit_short(OP_GET_SUPER, identifier_constant(expr.method.lexeme));
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::ThisExpr& expr) {
+    line = expr.keyword.line;
+    load_variable(expr.local, "this");
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::UnaryExpr& expr) {
+    compile(expr.right);
+    line = expr.op.line;
+    switch (expr.op.type) {
+    case BANG:
+        emit(OP_NOT);
+        break;
+    case MINUS:
+        emit(OP_NEGATE);
+        break;
+    default:
+        break;
+    }
+    return {};
+}
+
+lox::Value lox::Compiler::visit(lox::VariableExpr& expr) {
+    line = expr.name.line;
+    load_variable(expr.local, expr.name.lexeme);
+    return {};
+}
+
+void lox::Compiler::visit(lox::BlockStmt& stmt) {
+    begin_scope();
+    if (!stmt.framed)
+        scopes.push_back({current, {}});
+    for (const auto& statement : stmt.statements)
+        compile(statement);
+    if (!stmt.framed)
+        scopes.pop_back();
+    end_scope();
+}
+
+void lox::Compiler::visit(lox::ClassStmt& stmt) {
+    line                = stmt.name.line;
+    const uint16_t name = identifier_constant(stmt.name.lexeme);
+    emit_short(OP_CLASS, name);
+    const int klass      = define_variable(stmt.name.lexeme);
+    auto      load_class = [&] {
+        if (klass < 0)
+            emit_short(OP_GET_GLOBAL, vm.global_slot(stmt.name.lexeme));
+        else
+            emit(OP_GET_LOCAL, klass);
+    };
+    if (stmt.superclass) {
+        visit(*stmt.superclass);
+        begin_scope();
+        scopes.push_back({current, {}});
+        add_local(); // super
+        load_class();
+        line = stmt.superclass->name.line;
+        emit(OP_INHERIT);
+    }
+    load_class();
+    for (const auto& method : stmt.methods) {
+        line = method->name.line;
+        function(*method, method->name.lexeme == "init" ? FunctionType::INITIALIZER : FunctionType::METHOD);
+        emit_short(OP_METHOD, identifier_constant(method->name.lexeme));
+    }
+    emit(OP_POP);
+    if (stmt.superclass) {
+        scopes.pop_back();
+        end_scope();
+    }
+}
+
+void lox::Compiler::visit(lox::FnStmt& stmt) {
+    line = stmt.name.line;
+    if (current->scope_depth > 0) {
+        add_local(); // declared first so the body can call itself
+        function(stmt, FunctionType::FUNCTION);
+    } else {
+        function(stmt, FunctionType::FUNCTION);
+        define_variable(stmt.name.lexeme);
+    }
+}
+
+void lox::Compiler::visit(lox::IfStmt& stmt) {
+    compile(stmt.condition);
+    const size_t otherwise = emit_jump(OP_JUMP_IF_FALSE);
+    emit(OP_POP);
+    compile(stmt.then);
+    const size_t end = emit_jump(OP_JUMP);
+    patch_jump(otherwise);
+    emit(OP_POP);
+    if (stmt.otherwise)
+        compile(stmt.otherwise);
+    patch_jump(end);
+}
+
+void lox::Compiler::visit(lox::VarStmt& stmt) {
+    if (stmt.initializer)
+        compile(stmt.initializer);
+    else
+        emit(OP_NIL);
+    line = stmt.name.line;
+    define_variable(stmt.name.lexeme);
+}
+
+void lox::Compiler::visit(lox::PrintStmt& stmt) {
+    compile(stmt.expr);
+    emit(OP_PRINT);
+}
+
+void lox::Compiler::visit(lox::ExprStmt& stmt) {
+    compile(stmt.expr);
+    emit(OP_POP);
+}
+
+void lox::Compiler::visit(lox::ReturnStmt& stmt) {
+    line = stmt.keyword.line;
+    if (!stmt.value) {
+        emit_return();
+        return;
+    }
+    compile(stmt.value);
+    emit(OP_RETURN);
+}
+
+void lox::Compiler::visit(lox::WhileStmt& stmt) {
+    const size_t start = chunk().code.size();
+    compile(stmt.condition);
+    const size_t exit = emit_jump(OP_JUMP_IF_FALSE);
+    emit(OP_POP);
+    compile(stmt.body);
+    emit_loop(start);
+    patch_jump(exit);
+    emit(OP_POP);
+}
+
+std::shared_ptr<lox::Prototype> lox::Compiler::compile(std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    FunctionState script(nullptr, std::make_shared<Prototype>("script"), FunctionType::SCRIPT, false);
+    script.locals.push_back({0, false});
+    current = &script;
+    for (const auto& statement : statements)
+        compile(statement);
+    emit_return();
+    current = nullptr;
+    return std::move(script.function);
+}
@@ -2,38 +2,49 @@
 
 #include "error.hpp"
 
-void lox::Environment::define(const std::string& name, Value value) {
-    values[name] = value;
+void lox::Environment::trace(lox::Tracer& tracer) {
+    for (const Value& value : values)
+        tracer(value);
+    tracer(enclosing);
 }
 
-void lox::Environment::assign(const lox::Token& name, Value value) {
-    if (values.contains(name.lexeme))
-        values[name.lexeme] = value;
-    else if (enclosing != nullptr)
-        enclosing->assign(name, value);
-    else
-        throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'");
+void lox::Environment::clear() {
+    values.clear();
+    enclosing = nullptr;
+}
+
+void lox::Environment::define(Value value) {
+    values.emplace_back(std::move(value));
 }
 
-void lox::Environment::assign_at(const int distance, const Token& name, Value value) {
-    ancestor(distance)->values[name.lexeme] = value;
+void lox::Environment::assign_at(const int distance, const int slot, Value value) {
+    ancestor(distance)->values[slot] = std::move(value);
 }
 
-std::shared_ptr<lox::Environment> lox::Environment::ancestor(const int distance) {
-    std::shared_ptr<Environment> environment = shared_from_this();
+lox::Environment* lox::Environment::ancestor(const int distance) {
+    Environment* environment = this;
     for (int i = 0; i < distance; i++)
-        environment = environment->enclosing;
+        environment = environment->enclosing.get();
     return environment;
 }
 
-lox::Value lox::Environment::get(const lox::Token& name) {
-    if (values.contains(name.lexeme))
-        return values[name.lexeme];
-    if (enclosing != nullptr)
-        return enclosing->get(name);
-    throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'");
+lox::Value lox::Environment::get_at(const int distance, const int slot) {
+    return ancestor(distance)->values[slot];
+}
+
+void lox::GlobalEnvironment::define(lox::Ref<lox::LoxString> name, Value value) {
+    values[std::move(name)] = std::move(value);
+}
+
+void lox::GlobalEnvironment::assign(const lox::Token& name, Value value) {
+    if (auto it = values.find(name.symbol); it != values.end())
+        it->second = std::move(value);
+    else
+        throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme) + "'");
 }
 
-lox::Value lox::Environment::get_at(const int distance, const std::string& name) {
-    return ancestor(distance)->values[name];
+lox::Value lox::GlobalEnvironment::get(const lox::Token& name) {
+    if (auto it = values.find(name.symbol); it != values.end())
+        return it->second;
+    throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme) + "'");
 }
@@ -1,10 +1,14 @@
 #include "error.hpp"
 
-#include "lox.hpp"
+#include <iostream>
 
 bool lox::had_error         = false;
 bool lox::had_runtime_error = false;
 
+void lox::report(const int line, const std::string& where, const std::string& message) {
+    std::cerr << "[line " << line << "] Error" << where << ": " << message << "\n";
+}
+
 void lox::error(const std::string& message, const int line) {
     had_error = true;
     report(line, "", message);
@@ -15,10 +19,10 @@ void lox::error(const lox::Token& token, const std::string& message) {
     if (token.type == END)
         report(token.line, " at end", message);
     else
-        report(token.line, " at '" + token.lexeme + "'", message);
+        report(token.line, " at '" + std::string(token.lexeme) + "'", message);
 }
 
 void lox::runtime_error(const lox::RuntimeError& error) {
-    std::cerr << error.what() << " [line " << error.token.line << "]\n";
+    std::cerr << error.what() << " [line " << error.line << "]\n";
     had_runtime_error = true;
 }
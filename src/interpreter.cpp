@@ -4,81 +4,70 @@
 #include "lox_class.hpp"
 #include "lox_function.hpp"
 #include "lox_instance.hpp"
-#include "return.hpp"
+#include "lox_list.hpp"
+#include "lox_map.hpp"
+#include "native.hpp"
+#include "profiler.hpp"
+#include "sampler.hpp"
+#include "stats.hpp"
 
-#include <chrono>
-
-struct Clock : public lox::LoxCallable {
-
-    size_t arity() override {
-        return 0;
-    }
-
-    lox::Value call(lox::Interpreter& interpreter, std::vector<lox::Value>& args) override {
-        auto ticks = std::chrono::system_clock::now().time_since_epoch();
-        return std::chrono::duration<double>(ticks).count();
-    }
-
-    std::string to_string() const {
-        return "<fn clock>";
-    }
-};
+#include <algorithm>
 
 lox::Interpreter::Interpreter() {
-    std::shared_ptr<LoxCallable> clk = std::make_shared<Clock>();
-    globals->define("clock", std::move(clk));
+    define_natives(globals);
 }
 
 bool lox::Interpreter::is_truthy(const lox::Value& value) const {
-    if (std::holds_alternative<std::monostate>(value))
-        return false;
-    if (std::holds_alternative<bool>(value))
-        return get<bool>(value);
-    if (std::holds_alternative<double>(value))
-        return get<double>(value);
-    if (std::holds_alternative<std::string>(value))
-        return !get<std::string>(value).empty();
+    if (value.is_bool())
+        return value.as_bool();
+    if (value.is_number())
+        return value.as_number();
+    if (value.is_string())
+        return !value.as_string().empty();
+    if (value.is_list())
+        return !value.as<LoxList>()->elements.empty();
+    if (value.is_map())
+        return value.as<LoxMap>()->size() != 0;
     return false;
 }
 
 bool lox::Interpreter::is_equal(const Value& l, const Value& r) const {
-    return std::visit(
-        [&](const auto& l) -> bool {
-            return std::visit(
-                [&](const auto& r) -> bool {
-                    if constexpr (std::is_same_v<decltype(l), decltype(r)>)
-                        return l == r;
-                    return false;
-                },
-                r
-            );
-        },
-        l
-    );
+    return l == r;
 }
 
 void lox::Interpreter::check_number_operand(const lox::Token& op, const lox::Value& operand) const {
-    if (std::holds_alternative<double>(operand))
+    if (operand.is_number())
         return;
     throw RuntimeError(op, "Operand must be a number");
 }
 
 void lox::Interpreter::check_number_operands(const lox::Token& op, const lox::Value& left, const lox::Value& right) const {
-    if (std::holds_alternative<double>(left) and std::holds_alternative<double>(right))
+    if (left.is_number() and right.is_number())
         return;
     throw RuntimeError(op, "Operands must be numbers");
 }
 
 void lox::Interpreter::execute(std::unique_ptr<lox::Stmt>& statement) {
+    if (profiler)
+        profiler->hit(statement->line);
+    if (sampler)
+        sampler->at(statement->line);
     statement->accept(*this);
 }
 
-void lox::Interpreter::execute_block(std::vector<std::unique_ptr<lox::Stmt>>& statements, std::shared_ptr<Environment> environment) {
-    std::shared_ptr<Environment> previous = std::move(this->environment);
+void lox::Interpreter::execute_all(std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    for (auto& statement : statements) {
+        execute(statement);
+        if (returning)
+            break;
+    }
+}
+
+void lox::Interpreter::execute_block(std::vector<std::unique_ptr<lox::Stmt>>& statements, Ref<Environment> environment) {
+    Ref<Environment> previous = std::move(this->environment);
     try {
         this->environment = std::move(environment);
-        for (auto& statement : statements)
-            execute(statement);
+        execute_all(statements);
         this->environment = std::move(previous);
     } catch (...) {
         this->environment = std::move(previous);
@@ -86,6 +75,45 @@ void lox::Interpreter::execute_block(std::vector<std::unique_ptr<lox::Stmt>>& st
     }
 }
 
+lox::Value lox::Interpreter::take_returned() {
+    if (!returning)
+        return {};
+    returning = false;
+    return std::move(returned);
+}
+
+lox::Value lox::Interpreter::execute_body(std::vector<std::unique_ptr<lox::Stmt>>& statements, Ref<Environment> environment) {
+    execute_block(statements, std::move(environment));
+    return take_returned();
+}
+
+// the receiver and arguments are copied to the top of the value stack, followed by the function's other locals.
+// the closure stays current so the enclosing scopes are still found at the depths the resolver counted
+lox::Value lox::Interpreter::execute_frame(lox::FnStmt& function, Ref<Environment> closure, const lox::Value* receiver, lox::Arguments arguments) {
+    if (function.slots > static_cast<size_t>(stack.get() + STACK_MAX - stack_top))
+        throw RuntimeError(function.name, "Stack overflow");
+    Value* base = stack_top;
+    if (receiver)
+        *stack_top++ = *receiver;
+    for (Value& argument : arguments)
+        *stack_top++ = std::move(argument);
+    stack_top                  = base + function.slots;
+    Value*           previous  = std::exchange(frame, base);
+    Ref<Environment> enclosing = std::exchange(environment, std::move(closure));
+    try {
+        execute_all(function.body);
+    } catch (...) {
+        frame       = previous;
+        environment = std::move(enclosing);
+        pop(base);
+        throw;
+    }
+    frame       = previous;
+    environment = std::move(enclosing);
+    pop(base);
+    return take_returned();
+}
+
 lox::Value lox::Interpreter::evaluate(lox::Expr& expr) {
     return expr.accept(*this);
 }
@@ -96,13 +124,86 @@ lox::Value lox::Interpreter::evaluate(std::unique_ptr<lox::Expr>& expr) {
 
 lox::Value lox::Interpreter::visit(lox::AssignExpr& expr) {
     Value value = evaluate(expr.value);
-    environment->assign(expr.name, std::move(value));
+    if (expr.local.is_global())
+        globals.assign(expr.name, value);
+    else if (expr.local.is_frame())
+        frame[expr.local.slot] = value;
+    else
+        environment->assign_at(expr.local.depth, expr.local.slot, value);
     return value;
 }
 
+// a specialized site checks its guard and computes the result directly, skipping the generic dispatch below
 lox::Value lox::Interpreter::visit(lox::BinaryExpr& expr) {
     Value left  = evaluate(expr.left);
     Value right = evaluate(expr.right);
+    switch (expr.specialization) {
+    case Specialization::UNINITIALIZED:
+        expr.specialization = specialize(expr.op.type, left, right);
+        return binary(expr, left, right);
+    case Specialization::GENERIC:
+        return binary(expr, left, right);
+    case Specialization::STRING_CONCAT:
+        if (left.is_string() and right.is_string())
+            return left.as_string() + right.as_string();
+        break;
+    default:
+        if (!left.is_number() or !right.is_number())
+            break;
+        const double l = left.as_number();
+        const double r = right.as_number();
+        switch (expr.specialization) {
+        case Specialization::NUMBER_ADD:
+            return l + r;
+        case Specialization::NUMBER_SUBTRACT:
+            return l - r;
+        case Specialization::NUMBER_MULTIPLY:
+            return l * r;
+        case Specialization::NUMBER_DIVIDE:
+            return l / r;
+        case Specialization::NUMBER_GREATER:
+            return l > r;
+        case Specialization::NUMBER_GREATER_EQUAL:
+            return l >= r;
+        case Specialization::NUMBER_LESSER:
+            return l < r;
+        default:
+            return l <= r;
+        }
+    }
+    expr.specialization = Specialization::GENERIC;
+    return binary(expr, left, right);
+}
+
+lox::Specialization lox::Interpreter::specialize(const lox::TokenType op, const lox::Value& left, const lox::Value& right) const {
+    if (left.is_number() and right.is_number()) {
+        switch (op) {
+        case PLUS:
+            return Specialization::NUMBER_ADD;
+        case MINUS:
+            return Specialization::NUMBER_SUBTRACT;
+        case STAR:
+            return Specialization::NUMBER_MULTIPLY;
+        case SLASH:
+            return Specialization::NUMBER_DIVIDE;
+        case GREATER:
+            return Specialization::NUMBER_GREATER;
+        case GREATER_EQUAL:
+            return Specialization::NUMBER_GREATER_EQUAL;
+        case LESSER:
+            return Specialization::NUMBER_LESSER;
+        case LESSER_EQUAL:
+            return Specialization::NUMBER_LESSER_EQUAL;
+        default:
+            break;
+        }
+    }
+    if (op == PLUS and left.is_string() and right.is_string())
+        return Specialization::STRING_CONCAT;
+    return Specialization::GENERIC;
+}
+
+lox::Value lox::Interpreter::binary(lox::BinaryExpr& expr, const lox::Value& left, const lox::Value& right) {
     switch (expr.op.type) {
     case BANG_EQUAL:
         return !is_equal(left, right);
@@ -116,8 +217,8 @@ lox::Value lox::Interpreter::visit(lox::BinaryExpr& expr) {
     case LESSER:
     case LESSER_EQUAL: {
         check_number_operands(expr.op, left, right);
-        const double l = std::get<double>(left);
-        const double r = std::get<double>(right);
+        const double l = left.as_number();
+        const double r = right.as_number();
         switch (expr.op.type) {
         case MINUS:
             return l - r;
@@ -136,9 +237,9 @@ lox::Value lox::Interpreter::visit(lox::BinaryExpr& expr) {
         }
     }
     case PLUS:
-        if (std::holds_alternative<double>(left) and std::holds_alternative<double>(right))
-            return std::get<double>(left) + std::get<double>(right);
-        if (std::holds_alternative<std::string>(left) or std::holds_alternative<std::string>(right))
+        if (left.is_number() and right.is_number())
+            return left.as_number() + right.as_number();
+        if (left.is_string() or right.is_string())
             return stringfy(left) + stringfy(right);
         throw RuntimeError(expr.op, "cannot add " + stringfy(left) + " and " + stringfy(right));
     }
@@ -146,34 +247,134 @@ lox::Value lox::Interpreter::visit(lox::BinaryExpr& expr) {
 }
 
 lox::Value lox::Interpreter::visit(lox::CallExpr& expr) {
-    Value        callee = evaluate(expr.callee);
-    LoxCallable* function;
+    if (expr.method)
+        return invoke(expr, *expr.method);
+    if (expr.super)
+        return invoke_super(expr, *expr.super);
+    return call(expr, evaluate(expr.callee));
+}
+
+// arguments are evaluated straight onto the value stack and read there by the callee, they are popped once it returns
+lox::Value lox::Interpreter::call_with_arguments(lox::CallExpr& expr, lox::LoxCallable& callee, const lox::Value* receiver) {
+    if (expr.arguments.size() != callee.arity())
+        throw RuntimeError(
+            expr.paren, "Expected " + std::to_string(callee.arity()) + " arguments but got " + std::to_string(expr.arguments.size())
+        );
+    Value* base = stack_top;
     try {
-        function = std::get<std::shared_ptr<LoxCallable>>(callee).get();
+        for (auto& argument : expr.arguments) {
+            Value value = evaluate(argument);
+            if (stack_top == stack.get() + STACK_MAX)
+                throw RuntimeError(expr.paren, "Stack overflow");
+            *stack_top++ = std::move(value);
+        }
+        Arguments arguments(base, stack_top);
+        Value     result = receiver ? callee.call_method(*this, *receiver, arguments) : callee.call(*this, arguments);
+        pop(base);
+        return result;
+    } catch (const NativeError& error) {
+        pop(base);
+        throw RuntimeError(expr.paren, error.what());
     } catch (...) {
-        throw RuntimeError(expr.paren, "Can only call functions and methods");
+        pop(base);
+        throw;
     }
-    if (expr.arguments.size() != function->arity())
-        throw RuntimeError(
-            expr.paren, "Expected " + std::to_string(function->arity()) + " arguments but got " + std::to_string(expr.arguments.size())
-        );
-    std::vector<Value> arguments;
-    for (auto& args : expr.arguments)
-        arguments.emplace_back(evaluate(args));
-    return function->call(*this, arguments);
+}
+
+void lox::Interpreter::pop(lox::Value* base) {
+    while (stack_top != base)
+        *--stack_top = {};
+}
+
+// a method looked up and called on the spot gets its receiver directly instead of through a bound method
+lox::Value lox::Interpreter::invoke(lox::CallExpr& expr, lox::GetExpr& get) {
+    Value object = evaluate(get.object);
+    if (object.is_list() or object.is_map()) {
+        LoxCallable* method = builtin_method(object, get.name.symbol.get());
+        if (method == nullptr)
+            throw RuntimeError(get.name, "Undefined Property");
+        return call_with_arguments(expr, *method, &object);
+    }
+    if (!object.is_instance())
+        throw RuntimeError(get.name, "Only instances have properties.");
+    LoxInstance* instance = object.as<LoxInstance>();
+    if (Value* field = instance->field(get.name.symbol.get(), get.cache))
+        return call(expr, *field);
+    Ref<LoxCallable> method = instance->klass->find_method(get.name.symbol.get());
+    if (method == nullptr)
+        throw RuntimeError(get.name, "Undefined Property");
+    return call_with_arguments(expr, *method, &object);
+}
+
+lox::Value lox::Interpreter::invoke_super(lox::CallExpr& expr, lox::SuperExpr& super) {
+    Ref<LoxCallable> method(super_method(super)); // the cache on the node may move on while the arguments run
+    Value            object = lookup_variable(super.keyword, super.receiver);
+    return call_with_arguments(expr, *method, &object);
+}
+
+lox::Value lox::Interpreter::call(lox::CallExpr& expr, lox::Value callee) {
+    if (!callee.is_callable())
+        throw RuntimeError(expr.paren, "Can only call functions and methods");
+    return call_with_arguments(expr, *callee.as<LoxCallable>(), nullptr);
 }
 
 lox::Value lox::Interpreter::visit(lox::GetExpr& expr) {
     Value object = evaluate(expr.object);
-    if (!std::holds_alternative<std::shared_ptr<LoxInstance>>(object))
+    if (object.is_list() or object.is_map()) {
+        LoxCallable* method = builtin_method(object, expr.name.symbol.get());
+        if (method == nullptr)
+            throw RuntimeError(expr.name, "Undefined Property");
+        return make_ref<BoundBuiltinMethod>(object, Ref<LoxCallable>(method));
+    }
+    if (!object.is_instance())
         throw RuntimeError(expr.name, "Only instances have properties.");
-    return std::get<std::shared_ptr<LoxInstance>>(object)->get(expr.name);
+    return object.as<LoxInstance>()->get(expr.name, expr.cache);
 }
 
 lox::Value lox::Interpreter::visit(lox::GroupingExpr& expr) {
     return evaluate(expr.expr);
 }
 
+lox::Value lox::Interpreter::visit(lox::IndexExpr& expr) {
+    Value object = evaluate(expr.object);
+    if (!object.is_list() and !object.is_map())
+        throw RuntimeError(expr.bracket, "Only lists and maps can be indexed");
+    Value index = evaluate(expr.index);
+    try {
+        if (object.is_list())
+            return object.as<LoxList>()->at(index);
+        Value* value = object.as<LoxMap>()->find(index);
+        return value ? *value : Value();
+    } catch (const NativeError& error) {
+        throw RuntimeError(expr.bracket, error.what());
+    }
+}
+
+lox::Value lox::Interpreter::visit(lox::IndexSetExpr& expr) {
+    Value object = evaluate(expr.object);
+    if (!object.is_list() and !object.is_map())
+        throw RuntimeError(expr.bracket, "Only lists and maps can be indexed");
+    Value index = evaluate(expr.index);
+    Value value = evaluate(expr.value);
+    try {
+        if (object.is_list())
+            object.as<LoxList>()->at(index) = value;
+        else
+            object.as<LoxMap>()->set(index, value);
+    } catch (const NativeError& error) {
+        throw RuntimeError(expr.bracket, error.what());
+    }
+    return value;
+}
+
+lox::Value lox::Interpreter::visit(lox::ListExpr& expr) {
+    std::vector<Value> elements;
+    elements.reserve(expr.elements.size());
+    for (auto& element : expr.elements)
+        elements.push_back(evaluate(element));
+    return make_ref<LoxList>(std::move(elements));
+}
+
 lox::Value lox::Interpreter::visit(lox::LiteralExpr& expr) {
     return expr.value; // do not move this since we might want to refer to the value again in a loop
 }
@@ -190,28 +391,51 @@ lox::Value lox::Interpreter::visit(lox::LogicalExpr& expr) {
     return evaluate(expr.right);
 }
 
+lox::Value lox::Interpreter::visit(lox::MapExpr& expr) {
+    Ref<LoxMap> map = make_ref<LoxMap>();
+    map->reserve(expr.keys.size());
+    for (size_t i = 0; i < expr.keys.size(); i++) {
+        Value key   = evaluate(expr.keys[i]);
+        Value value = evaluate(expr.values[i]);
+        try {
+            map->set(key, std::move(value));
+        } catch (const NativeError& error) {
+            throw RuntimeError(expr.brace, error.what());
+        }
+    }
+    return map;
+}
+
 lox::Value lox::Interpreter::visit(lox::SetExpr& expr) {
     Value object = evaluate(expr.object);
-    if (!std::holds_alternative<std::shared_ptr<LoxInstance>>(object))
+    if (!object.is_instance())
         throw RuntimeError(expr.name, "Only instances have fields");
     Value value = evaluate(expr.value);
-    std::get<std::shared_ptr<LoxInstance>>(object).get()->set(expr.name, value);
+    object.as<LoxInstance>()->set(expr.name, value, expr.cache);
     return value;
 }
 
 lox::Value lox::Interpreter::visit(lox::SuperExpr& expr) {
-    const int                 distance = locals[&expr];
-    std::shared_ptr<LoxClass> superclass =
-        std::dynamic_pointer_cast<LoxClass>(std::get<std::shared_ptr<LoxCallable>>(environment->get_at(distance, "super")));
-    std::shared_ptr<LoxInstance> object = std::get<std::shared_ptr<LoxInstance>>(environment->get_at(distance - 1, "this"));
-    std::shared_ptr<LoxFunction> method = superclass->find_method(expr.method.lexeme);
-    if (method == nullptr)
-        throw RuntimeError(expr.method, "Undefined property '" + expr.method.lexeme + "'");
-    return method->bind(std::move(object));
+    LoxCallable* method = super_method(expr);
+    Value        object = lookup_variable(expr.keyword, expr.receiver);
+    return method->bind(Ref<LoxInstance>(object.as<LoxInstance>()));
+}
+
+// the superclass behind a super expression only changes when its class declaration runs again
+lox::LoxCallable* lox::Interpreter::super_method(lox::SuperExpr& expr) {
+    Value superclass = lookup_variable(expr.keyword, expr.local);
+    if (!expr.superclass.is_object() or expr.superclass.as_object() != superclass.as_object()) {
+        Ref<LoxCallable> method = superclass.as<LoxClass>()->find_method(expr.method.symbol.get());
+        if (method == nullptr)
+            throw RuntimeError(expr.method, "Undefined property '" + std::string(expr.method.lexeme) + "'");
+        expr.superclass = std::move(superclass);
+        expr.resolved   = std::move(method);
+    }
+    return expr.resolved.as<LoxCallable>();
 }
 
 lox::Value lox::Interpreter::visit(lox::ThisExpr& expr) {
-    return lookup_variable(expr.keyword, &expr);
+    return lookup_variable(expr.keyword, expr.local);
 }
 
 lox::Value lox::Interpreter::visit(UnaryExpr& expr) {
@@ -221,46 +445,45 @@ lox::Value lox::Interpreter::visit(UnaryExpr& expr) {
         return std::move(!is_truthy(right));
     case MINUS:
         check_number_operand(expr.op, right);
-        return -get<double>(right);
+        return -right.as_number();
     }
     return "\n(unary expr) something's wrong if you can see this\n";
 }
 
 lox::Value lox::Interpreter::visit(lox::VariableExpr& expr) {
-    return lookup_variable(expr.name, &expr);
+    return lookup_variable(expr.name, expr.local);
 }
 
 void lox::Interpreter::visit(lox::BlockStmt& statement) {
-    execute_block(statement.statements, std::make_shared<Environment>(environment));
+    if (statement.framed)
+        return execute_all(statement.statements);
+    execute_block(statement.statements, make_ref<Environment>(environment, statement.slots));
 }
 
 void lox::Interpreter::visit(lox::ClassStmt& statement) {
-    Value                     superclass;
-    std::shared_ptr<LoxClass> superclassptr;
+    Value         superclass;
+    Ref<LoxClass> superclassptr;
     if (statement.superclass) {
         superclass = evaluate(*statement.superclass.get());
-        if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(superclass))
-            throw RuntimeError(statement.superclass->name, "superclass must be a class");
-        if (auto sc = std::dynamic_pointer_cast<LoxClass>(std::get<std::shared_ptr<LoxCallable>>(superclass)); !sc)
+        if (!superclass.is_object() or superclass.as_object()->type != ObjectType::CLASS)
             throw RuntimeError(statement.superclass->name, "superclass must be a class");
-        else
-            superclassptr = sc;
+        superclassptr = Ref<LoxClass>(superclass.as<LoxClass>());
     }
     if (statement.superclass) {
-        environment = std::make_shared<Environment>(environment);
-        environment->define("super", superclass);
+        environment = make_ref<Environment>(environment, 1);
+        environment->define(superclass);
     }
-    std::unordered_map<std::string, std::shared_ptr<LoxFunction>> methods;
+    SymbolMap<Ref<LoxCallable>> methods;
     for (auto& method : statement.methods)
-        methods[method->name.lexeme] = std::make_shared<LoxFunction>(*method.get(), environment, method->name.lexeme == "init");
-    std::shared_ptr<LoxClass> klass = std::make_shared<LoxClass>(statement.name.lexeme, methods, superclassptr);
+        methods[method->name.symbol] = make_ref<LoxFunction>(*method.get(), environment, method->name.lexeme == "init", true);
+    Ref<LoxClass> klass = make_ref<LoxClass>(std::string(statement.name.lexeme), methods, superclassptr);
     if (superclassptr)
         environment = environment->enclosing;
-    environment->define(statement.name.lexeme, klass);
+    define(statement.name, klass);
 }
 
 void lox::Interpreter::visit(lox::FnStmt& statement) {
-    environment->define(statement.name.lexeme, std::make_shared<LoxFunction>(statement, environment, false));
+    define(statement.name, make_ref<LoxFunction>(statement, environment, false));
 }
 
 void lox::Interpreter::visit(lox::IfStmt& statement) {
@@ -283,23 +506,39 @@ void lox::Interpreter::visit(lox::VarStmt& statement) {
     Value value;
     if (statement.initializer != nullptr)
         value = evaluate(statement.initializer);
-    environment->define(statement.name.lexeme, value);
+    if (statement.local.is_frame())
+        frame[statement.local.slot] = std::move(value);
+    else
+        define(statement.name, std::move(value));
 }
 
 void lox::Interpreter::visit(lox::ReturnStmt& statement) {
-    throw Return(evaluate(statement.value));
+    runtime_stats().returns++;
+    returned  = statement.value ? evaluate(statement.value) : Value{};
+    returning = true;
 }
 
 void lox::Interpreter::visit(lox::WhileStmt& statement) {
-    while (is_truthy(evaluate(statement.condition)))
+    while (is_truthy(evaluate(statement.condition))) {
         execute(statement.body);
+        if (returning)
+            return;
+    }
 }
 
-lox::Value lox::Interpreter::lookup_variable(const lox::Token& name, lox::Expr* expr) {
-    if (locals.contains(expr))
-        return environment->get_at(locals[expr], name.lexeme);
+void lox::Interpreter::define(const lox::Token& name, lox::Value value) {
+    if (environment)
+        environment->define(std::move(value));
+    else
+        globals.define(name.symbol, std::move(value));
+}
 
-    return globals->get(name);
+lox::Value lox::Interpreter::lookup_variable(const lox::Token& name, const lox::Local& local) {
+    if (local.is_global())
+        return globals.get(name);
+    if (local.is_frame())
+        return frame[local.slot];
+    return environment->get_at(local.depth, local.slot);
 }
 
 void lox::Interpreter::interpret(std::vector<std::unique_ptr<lox::Stmt>>& statements) {
@@ -311,22 +550,37 @@ void lox::Interpreter::interpret(std::vector<std::unique_ptr<lox::Stmt>>& statem
     }
 }
 
-void lox::Interpreter::resolve(lox::Expr* expr, const int depth) {
-    locals[expr] = depth;
-}
 
 std::string lox::Interpreter::stringfy(const lox::Value& value) const {
-    if (std::holds_alternative<std::monostate>(value))
+    if (value.is_nil())
         return "nil";
-    if (std::holds_alternative<bool>(value))
-        return is_truthy(value) ? "true" : "false";
-    if (std::holds_alternative<double>(value))
-        return std::to_string(std::get<double>(value));
-    if (std::holds_alternative<std::string>(value))
-        return std::get<std::string>(value);
-    if (std::holds_alternative<std::shared_ptr<LoxCallable>>(value))
-        return std::get<std::shared_ptr<LoxCallable>>(value)->to_string();
-    if (std::holds_alternative<std::shared_ptr<LoxInstance>>(value))
-        return std::get<std::shared_ptr<LoxInstance>>(value)->to_string();
+    if (value.is_bool())
+        return value.as_bool() ? "true" : "false";
+    if (value.is_number())
+        return std::to_string(value.as_number());
+    if (value.is_string())
+        return value.as_string();
+    if (value.is_callable())
+        return value.as<LoxCallable>()->to_string();
+    if (value.is_instance())
+        return value.as<LoxInstance>()->to_string();
+    if (value.is_list() or value.is_map()) {
+        static std::vector<const Object*> printing; // a list or map that holds itself prints as [...] or {...} inside
+        const bool list = value.is_list();
+        if (std::find(printing.begin(), printing.end(), value.as_object()) != printing.end())
+            return list ? "[...]" : "{...}";
+        printing.push_back(value.as_object());
+        std::string out;
+        const char* separator = "";
+        if (list)
+            for (const Value& element : value.as<LoxList>()->elements)
+                out += std::exchange(separator, ", ") + stringfy(element);
+        else
+            value.as<LoxMap>()->for_each([&](const Value& key, const Value& entry) {
+                out += std::exchange(separator, ", ") + stringfy(key) + ": " + stringfy(entry);
+            });
+        printing.pop_back();
+        return list ? "[" + out + "]" : "{" + out + "}";
+    }
     return "\n(stringify) something's wrong. this should not be reachable\n";
 }
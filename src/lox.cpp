@@ -1,37 +1,209 @@
 #include "lox.hpp"
 
+#include "cache.hpp"
+#include "compiler.hpp"
 #include "error.hpp"
 #include "interpreter.hpp"
+#include "optimizer.hpp"
 #include "parser.hpp"
+#include "profiler.hpp"
 #include "resolver.hpp"
+#include "sampler.hpp"
 #include "scanner.hpp"
+#include "stats.hpp"
+#include "vm.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fcntl.h>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// tokens point into the source they were scanned from, so every source stays around as long as its tree does
+std::deque<std::string>                              sources;
+std::vector<std::vector<std::unique_ptr<lox::Stmt>>> programs;
 
 lox::Interpreter interpreter;
+lox::VM          vm(interpreter);
+lox::Engine      engine = lox::Engine::TREE;
+
+bool   optimize   = false;
+bool   use_cache  = true;
+size_t eliminated = 0; // nodes removed by the optimizer over all runs
+
+constexpr size_t PARALLEL_SCAN_MIN = 1 << 20; // smaller sources are not worth starting threads for
+unsigned         scan_threads      = std::max(1u, std::thread::hardware_concurrency());
+
+lox::Profiler profiler;
+std::string   profile_folded; // where folded stacks go, if anywhere
+
+lox::Sampler sampler;
+unsigned     sample_frequency = 0; // 0 while sampling is off
+std::string  sample_folded;
+
+// milliseconds spent in each phase over all runs, for --stats
+struct Phases {
+    double cache    = 0; // loading and saving cached trees
+    double scan     = 0;
+    double parse    = 0;
+    double resolve  = 0;
+    double optimize = 0;
+    double compile  = 0;
+    double execute  = 0;
+} phases;
+
+const auto  started = std::chrono::steady_clock::now();
+bool        stats   = false;
+std::string stats_path; // stderr if empty
+
+// milliseconds since start, which moves on to now
+double lap(std::chrono::steady_clock::time_point& start) {
+    const auto now     = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration<double, std::milli>(now - start).count();
+    start              = now;
+    return elapsed;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc > 2) {
-        std::cerr << "usage lox [script]";
+    const char*              usage = "usage lox [--engine=tree|vm] [--optimize] [--optimize-stats] [--scan-threads=n] [--no-cache] [--profile] [--profile-folded=path] [--sample[=hz]] [--sample-folded=path] [--gc-threshold=n] [--gc-stats] [--stats[=path]] [script]";
+    std::vector<std::string> args(argv + 1, argv + argc);
+    while (!args.empty() and args.front().starts_with("--")) {
+        const std::string& flag = args.front();
+        if (flag.starts_with("--engine=")) {
+            const std::string name = flag.substr(9);
+            if (name == "vm")
+                engine = lox::Engine::VM;
+            else if (name != "tree") {
+                std::cerr << "unknown engine '" << name << "', expected tree or vm\n";
+                return 64;
+            }
+        } else if (flag.starts_with("--gc-threshold=")) {
+            const std::string threshold = flag.substr(15);
+            if (threshold.empty() or threshold.find_first_not_of("0123456789") != std::string::npos) {
+                std::cerr << "invalid gc threshold '" << threshold << "'\n";
+                return 64;
+            }
+            lox::heap().thresholds[0] = std::stoull(threshold);
+            lox::heap().enabled       = lox::heap().thresholds[0] != 0;
+        } else if (flag.starts_with("--scan-threads=")) {
+            const std::string threads = flag.substr(15);
+            if (threads.empty() or threads.find_first_not_of("0123456789") != std::string::npos or std::stoul(threads) == 0) {
+                std::cerr << "invalid scan thread count '" << threads << "'\n";
+                return 64;
+            }
+            scan_threads = std::stoul(threads);
+        } else if (flag == "--profile" or flag.starts_with("--profile-folded=")) {
+            if (flag != "--profile")
+                profile_folded = flag.substr(17);
+            interpreter.profiler = &profiler;
+        } else if (flag == "--sample" or flag.starts_with("--sample-folded=")) {
+            if (flag != "--sample")
+                sample_folded = flag.substr(16);
+            if (sample_frequency == 0)
+                sample_frequency = lox::Sampler::DEFAULT_FREQUENCY;
+        } else if (flag.starts_with("--sample=")) {
+            const std::string frequency = flag.substr(9);
+            if (frequency.empty() or frequency.find_first_not_of("0123456789") != std::string::npos or std::stoul(frequency) == 0) {
+                std::cerr << "invalid sampling frequency '" << frequency << "'\n";
+                return 64;
+            }
+            sample_frequency = std::stoul(frequency);
+        } else if (flag == "--no-cache")
+            use_cache = false;
+        else if (flag == "--optimize")
+            optimize = true;
+        else if (flag == "--optimize-stats")
+            std::atexit(lox::report_optimizer);
+        else if (flag == "--gc-stats")
+            std::atexit(lox::report_gc);
+        else if (flag == "--stats" or flag.starts_with("--stats=")) {
+            if (flag != "--stats")
+                stats_path = flag.substr(8);
+            if (!stats)
+                std::atexit(lox::report_stats);
+            stats = true;
+        }
+        else {
+            std::cerr << usage;
+            return 64;
+        }
+        args.erase(args.begin());
+    }
+    if (args.size() > 1) {
+        std::cerr << usage;
         return 64;
     }
-    if (argc == 2)
-        lox::run_file(argv[1]);
+    if ((interpreter.profiler or sample_frequency) and engine == lox::Engine::VM) {
+        std::cerr << "profiling is only supported by the tree engine\n";
+        return 64;
+    }
+    if (interpreter.profiler)
+        std::atexit(lox::report_profile);
+    if (sample_frequency) {
+        if (!sampler.start(sample_frequency)) {
+            std::cerr << "could not start the sampling timer\n";
+            return 71;
+        }
+        interpreter.sampler = &sampler;
+        std::atexit(lox::report_samples);
+    }
+    if (args.size() == 1)
+        lox::run_file(args.front());
     else
         lox::run_prompt();
     return 0;
 }
 
+// a regular file is mapped and scanned in place, the mapping is never released. anything else is read into memory.
+// the resolved tree of a regular file is cached in the user's cache directory
 void lox::run_file(const std::string& path) {
-    std::ifstream ifs(path);
-    if (!ifs.is_open()) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
         std::cerr << "No such file or directory\n";
         exit(66);
     }
-    const std::string source = std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
-    run(source);
+    std::string_view source;
+    std::string      cache;
+    struct stat      info;
+    if (fstat(fd, &info) == 0 and S_ISREG(info.st_mode)) {
+        if (use_cache)
+            cache = cache_path(path);
+        if (info.st_size > 0) {
+            void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                std::cerr << "Could not map " << path << "\n";
+                exit(74);
+            }
+            source = std::string_view(static_cast<const char*>(data), info.st_size);
+        }
+    } else {
+        std::ifstream ifs(path);
+        source = sources.emplace_back(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    close(fd);
+    std::vector<std::unique_ptr<Stmt>> statements;
+    auto                               start  = std::chrono::steady_clock::now();
+    const bool                         cached = !cache.empty() and load_cache(cache, source, statements);
+    phases.cache += lap(start);
+    if (!cached) {
+        statements = parse(source);
+        start      = std::chrono::steady_clock::now();
+        if (!had_error and !cache.empty())
+            save_cache(cache, source, statements);
+        phases.cache += lap(start);
+    }
+    if (!had_error)
+        execute(std::move(statements));
     if (had_error)
         exit(65);
     if (had_runtime_error)
@@ -44,27 +216,133 @@ void lox::run_prompt() {
         had_error = false;
         std::cout << ">> ";
         std::cout.flush();
-        std::getline(std::cin, source);
-        run(source);
+        if (!std::getline(std::cin, source)) {
+            std::cout << "\n";
+            return;
+        }
+        run(sources.emplace_back(std::move(source)));
     }
 }
 
-void lox::run(const std::string& source) {
-    Scanner            scanner(source);
-    std::vector<Token> tokens = scanner.scan_tokens();
+void lox::run(std::string_view source) {
+    std::vector<std::unique_ptr<Stmt>> statements = parse(source);
+    if (!had_error)
+        execute(std::move(statements));
+}
+
+// scans, parses and resolves a source, the result is only meaningful without errors
+std::vector<std::unique_ptr<lox::Stmt>> lox::parse(std::string_view source) {
+    auto               start = std::chrono::steady_clock::now();
+    std::vector<Token> tokens;
+    if (scan_threads > 1 and source.size() >= PARALLEL_SCAN_MIN)
+        tokens = Scanner::scan_parallel(source, scan_threads);
+    else
+        tokens = Scanner(source).scan_tokens();
+    phases.scan += lap(start);
     if (had_error)
-        return;
+        return {};
     Parser                             parser(tokens);
     std::vector<std::unique_ptr<Stmt>> statements = parser.parse();
+    phases.parse += lap(start);
     if (had_error)
-        return;
-    Resolver resolver(interpreter);
+        return {};
+    Resolver resolver;
     resolver.resolve(statements);
-    if (had_error)
+    phases.resolve += lap(start);
+    return statements;
+}
+
+void lox::execute(std::vector<std::unique_ptr<lox::Stmt>> statements) {
+    auto start = std::chrono::steady_clock::now();
+    if (optimize)
+        eliminated += Optimizer(interpreter).optimize(statements);
+    phases.optimize += lap(start);
+    if (engine == Engine::VM) {
+        Compiler                   compiler(vm);
+        std::shared_ptr<Prototype> script = compiler.compile(statements);
+        phases.compile += lap(start);
+        if (had_error)
+            return;
+        vm.interpret(std::move(script));
+        phases.execute += lap(start);
         return;
+    }
     interpreter.interpret(statements);
+    phases.execute += lap(start);
+    // functions keep pointing into their declarations, so the tree has to outlive the line that produced it
+    programs.push_back(std::move(statements));
+}
+
+void lox::report_optimizer() {
+    std::cerr << "[optimizer] " << eliminated << " nodes eliminated\n";
+}
+
+void lox::report_profile() {
+    profiler.report(std::cerr);
+    if (profile_folded.empty())
+        return;
+    std::ofstream out(profile_folded);
+    profiler.write_folded(out);
+    if (!out)
+        std::cerr << "[profile] could not write " << profile_folded << "\n";
+}
+
+void lox::report_samples() {
+    sampler.report(std::cerr);
+    if (sample_folded.empty())
+        return;
+    std::ofstream out(sample_folded);
+    sampler.write_folded(out);
+    if (!out)
+        std::cerr << "[sample] could not write " << sample_folded << "\n";
+}
+
+void lox::report_gc() {
+    const Heap& heap = lox::heap();
+    std::cerr << std::fixed << std::setprecision(3);
+    for (int generation = 0; generation < Heap::GENERATIONS; generation++) {
+        const GcStats& stats = heap.stats[generation];
+        std::cerr << "[gc] generation " << generation << ": " << stats.collections << " collections, " << stats.freed
+                  << " objects freed, " << stats.total_pause << " ms paused, " << stats.max_pause << " ms longest pause\n";
+    }
+    size_t allocated = 0;
+    for (const size_t count : heap.allocated)
+        allocated += count;
+    std::cerr << "[gc] " << allocated << " objects allocated, " << heap.tracked << " objects tracked\n";
 }
 
-void lox::report(const int line, const std::string& where, const std::string& message) {
-    std::cerr << "[line " << line << "] Error" << where << ": " << message << "\n";
+// one json object, on one line so reports of several runs can be collected into a json lines file
+void lox::report_stats() {
+    static constexpr const char* TYPE_NAMES[OBJECT_TYPES] = {"string", "environment", "upvalue", "instance",
+                                                             "list",   "map",         "native",  "function",
+                                                             "class",  "closure",     "bound_method"};
+    const Heap& heap  = lox::heap();
+    auto        start = started;
+    const double total = lap(start);
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\"engine\": \"" << (engine == Engine::VM ? "vm" : "tree") << "\", \"phases_ms\": {\"cache\": " << phases.cache
+        << ", \"scan\": " << phases.scan << ", \"parse\": " << phases.parse << ", \"resolve\": " << phases.resolve
+        << ", \"optimize\": " << phases.optimize << ", \"compile\": " << phases.compile << ", \"execute\": " << phases.execute
+        << ", \"total\": " << total << "}, \"allocations\": {";
+    size_t allocated = 0;
+    for (size_t type = 0; type < OBJECT_TYPES; type++) {
+        out << "\"" << TYPE_NAMES[type] << "\": " << heap.allocated[type] << ", ";
+        allocated += heap.allocated[type];
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    out << "\"total\": " << allocated << "}, \"binds\": " << runtime_stats().binds << ", \"returns\": " << runtime_stats().returns
+        << ", \"live_objects\": " << heap.live << ", \"peak_live_objects\": " << heap.peak_live
+        << ", \"peak_rss_kb\": " << usage.ru_maxrss << "}\n";
+
+    if (stats_path.empty()) {
+        std::cerr << out.str();
+        return;
+    }
+    std::ofstream file(stats_path);
+    file << out.str();
+    if (!file)
+        std::cerr << "[stats] could not write " << stats_path << "\n";
 }
@@ -0,0 +1,7 @@
+#include "lox_callable.hpp"
+
+#include "lox_instance.hpp"
+
+lox::Value lox::LoxCallable::call_method(lox::Interpreter& interpreter, const lox::Value& receiver, lox::Arguments arguments) {
+    return bind(Ref<LoxInstance>(receiver.as<LoxInstance>()))->call(interpreter, arguments);
+}
@@ -2,27 +2,59 @@
 
 #include "lox_function.hpp"
 #include "lox_instance.hpp"
+#include "profiler.hpp"
+
+lox::LoxClass::LoxClass(std::string name, SymbolMap<Ref<LoxCallable>> methods, Ref<LoxClass> superclass)
+    : LoxCallable(ObjectType::CLASS), name(std::move(name)) {
+    if (superclass)
+        inherit(std::move(superclass));
+    for (auto& [symbol, method] : methods)
+        add_method(symbol, std::move(method));
+}
+
+void lox::LoxClass::inherit(lox::Ref<lox::LoxClass> parent) {
+    superclass = std::move(parent);
+    for (const auto& [name, method] : superclass->methods)
+        add_method(name, method);
+}
+
+void lox::LoxClass::add_method(lox::Ref<lox::LoxString> name, lox::Ref<lox::LoxCallable> method) {
+    static const Ref<LoxString> init_name = LoxString::intern("init");
+    if (name == init_name)
+        init = method;
+    methods[std::move(name)] = std::move(method);
+}
+
+void lox::LoxClass::trace(lox::Tracer& tracer) {
+    for (const auto& [name, method] : methods)
+        tracer(method);
+    tracer(superclass);
+    tracer(init);
+}
+
+void lox::LoxClass::clear() {
+    methods.clear();
+    superclass = nullptr;
+    init       = nullptr;
+}
 
 size_t lox::LoxClass::arity() {
-    std::shared_ptr<LoxFunction> init = find_method("init");
     if (init == nullptr)
         return 0;
     return init->arity();
 }
 
-lox::Value lox::LoxClass::call(lox::Interpreter& interpreter, std::vector<lox::Value>& arguments) {
-    std::shared_ptr<LoxInstance> instance = std::make_shared<LoxInstance>(shared_from_this());
-    std::shared_ptr<LoxFunction> init     = find_method("init");
+lox::Value lox::LoxClass::call(lox::Interpreter& interpreter, lox::Arguments arguments) {
+    Profiler::Scope profile(interpreter.profiler, this, name, 0, this);
+    Value instance = make_ref<LoxInstance>(Ref<LoxClass>(this));
     if (init != nullptr)
-        init->bind(instance)->call(interpreter, arguments);
+        init->call_method(interpreter, instance, arguments);
     return instance;
 }
 
-std::shared_ptr<lox::LoxFunction> lox::LoxClass::find_method(const std::string& name) {
-    if (methods.contains(name))
-        return methods[name];
-    if (superclass)
-        return superclass->find_method(name);
+lox::Ref<lox::LoxCallable> lox::LoxClass::find_method(const lox::LoxString* name) {
+    if (auto it = methods.find(name); it != methods.end())
+        return it->second;
     return {};
 }
 
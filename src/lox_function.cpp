@@ -2,34 +2,56 @@
 
 #include "environment.hpp"
 #include "lox_instance.hpp"
-#include "return.hpp"
-
-lox::Value lox::LoxFunction::call(Interpreter& interpreter, std::vector<Value>& arguments) {
-    std::shared_ptr<Environment> environment = std::make_shared<Environment>(closure);
-    for (int i = 0; i < arguments.size(); i++)
-        environment->define((declaration.params)[i].lexeme, arguments[i]);
-    try {
-        interpreter.execute_block(declaration.body, std::move(environment));
-    } catch (Return& value) {
-        if (is_init)
-            return closure->get_at(0, "this");
-        return value.value;
+#include "profiler.hpp"
+#include "sampler.hpp"
+#include "stats.hpp"
+
+lox::Value lox::LoxFunction::invoke(Interpreter& interpreter, const Value* receiver, Arguments arguments) {
+    Profiler::Scope  profile(interpreter.profiler, &declaration, declaration.name.lexeme, declaration.name.line);
+    Sampler::Scope   sample(interpreter.sampler, &declaration);
+    Value            result;
+    if (declaration.framed)
+        result = interpreter.execute_frame(declaration, closure, receiver, arguments);
+    else {
+        Ref<Environment> environment = make_ref<Environment>(closure, declaration.slots);
+        if (receiver)
+            environment->define(*receiver);
+        for (Value& argument : arguments)
+            environment->define(std::move(argument));
+        result = interpreter.execute_body(declaration.body, std::move(environment));
     }
     if (is_init)
-        return closure->get_at(0, "this");
-    return {};
+        return *receiver;
+    return result;
+}
+
+lox::Value lox::LoxFunction::call(Interpreter& interpreter, Arguments arguments) {
+    return invoke(interpreter, is_method ? &receiver : nullptr, arguments);
+}
+
+lox::Value lox::LoxFunction::call_method(Interpreter& interpreter, const Value& receiver, Arguments arguments) {
+    return invoke(interpreter, &receiver, arguments);
+}
+
+void lox::LoxFunction::trace(lox::Tracer& tracer) {
+    tracer(closure);
+    tracer(receiver);
+}
+
+void lox::LoxFunction::clear() {
+    closure  = nullptr;
+    receiver = {};
 }
 
 size_t lox::LoxFunction::arity() {
     return declaration.params.size();
 }
 
-std::shared_ptr<lox::LoxFunction> lox::LoxFunction::bind(std::shared_ptr<LoxInstance> instance) {
-    std::shared_ptr<Environment> enivornment = std::make_shared<Environment>(closure);
-    enivornment->define("this", std::move(instance));
-    return std::make_shared<LoxFunction>(declaration, std::move(enivornment), is_init);
+lox::Ref<lox::LoxCallable> lox::LoxFunction::bind(Ref<LoxInstance> instance) {
+    runtime_stats().binds++;
+    return make_ref<LoxFunction>(declaration, closure, is_init, true, std::move(instance));
 }
 
 std::string lox::LoxFunction::to_string() const {
-    return "<fn " + declaration.name.lexeme + ">";
+    return "<fn " + std::string(declaration.name.lexeme) + ">";
 }
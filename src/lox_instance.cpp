@@ -3,17 +3,65 @@
 #include "error.hpp"
 #include "lox_function.hpp"
 
-lox::Value lox::LoxInstance::get(const Token& name) {
-    if (fields.contains(name.lexeme))
-        return fields[name.lexeme];
-    std::shared_ptr<LoxFunction> method = klass->find_method(name.lexeme);
+void lox::LoxInstance::trace(lox::Tracer& tracer) {
+    tracer(klass);
+    for (const Value& value : fields)
+        tracer(value);
+}
+
+void lox::LoxInstance::clear() {
+    fields.clear();
+    klass = nullptr;
+}
+
+lox::Value* lox::LoxInstance::field(const lox::LoxString* name) {
+    const int slot = shape->lookup(name);
+    return slot < 0 ? nullptr : &fields[slot];
+}
+
+lox::Value* lox::LoxInstance::field(const lox::LoxString* name, lox::InlineCache& cache) {
+    if (const InlineCache::Entry* entry = cache.find(shape))
+        return &fields[entry->slot];
+    const int slot = shape->lookup(name);
+    if (slot < 0)
+        return nullptr;
+    cache.add(shape, shape, slot);
+    return &fields[slot];
+}
+
+void lox::LoxInstance::set_field(lox::LoxString* name, lox::Value value, lox::InlineCache& cache) {
+    Shape*   next;
+    uint32_t slot;
+    if (const InlineCache::Entry* entry = cache.find(shape)) {
+        next = entry->to;
+        slot = entry->slot;
+    } else {
+        const int found = shape->lookup(name);
+        next            = found < 0 ? shape->add(name) : shape;
+        slot            = found < 0 ? fields.size() : found;
+        cache.add(shape, next, slot);
+    }
+    if (next == shape) {
+        fields[slot] = std::move(value);
+        return;
+    }
+    shape = next; // adding a field always appends it
+    fields.push_back(std::move(value));
+}
+
+lox::Value lox::LoxInstance::get(const Token& name, lox::InlineCache& cache) {
+    if (Value* value = field(name.symbol.get(), cache))
+        return *value;
+    Ref<LoxCallable> method = klass->find_method(name.symbol.get());
     if (method)
-        return method->bind(shared_from_this());
+        return method->bind(Ref<LoxInstance>(this));
     throw RuntimeError(name, "Undefined Property");
 }
 
-void lox::LoxInstance::set(const Token& name, lox::Value value) {
-    fields[name.lexeme] = std::move(value);
+void lox::LoxInstance::set(const Token& name, lox::Value value, lox::InlineCache& cache) {
+    if (klass->frozen)
+        throw RuntimeError(name, "Fields of " + klass->name + " are read-only");
+    set_field(name.symbol.get(), std::move(value), cache);
 }
 
 std::string lox::LoxInstance::to_string() const {
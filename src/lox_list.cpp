@@ -0,0 +1,97 @@
+#include "lox_list.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// a whole number in [0, limit], what every position handed to a list has to be
+size_t position(const lox::Value& value, const size_t limit) {
+    if (!value.is_number())
+        throw lox::NativeError("List index must be a number");
+    const double index = value.as_number();
+    if (index != std::floor(index))
+        throw lox::NativeError("List index must be a whole number");
+    if (index < 0 or index > limit)
+        throw lox::NativeError("List index out of range");
+    return static_cast<size_t>(index);
+}
+
+lox::Value length(lox::LoxList& list, lox::Arguments) {
+    return static_cast<double>(list.elements.size());
+}
+
+lox::Value push(lox::LoxList& list, lox::Arguments arguments) {
+    list.elements.push_back(std::move(arguments[0]));
+    return {};
+}
+
+lox::Value pop(lox::LoxList& list, lox::Arguments) {
+    if (list.elements.empty())
+        throw lox::NativeError("Cannot pop from an empty list");
+    lox::Value last = std::move(list.elements.back());
+    list.elements.pop_back();
+    return last;
+}
+
+// in place and ascending, the elements have to be all numbers or all strings. NaN compares false with everything, so it
+// is ordered after every other number to keep the comparison a strict weak ordering
+lox::Value sort(lox::LoxList& list, lox::Arguments) {
+    std::vector<lox::Value>& elements = list.elements;
+    if (std::all_of(elements.begin(), elements.end(), [](const lox::Value& value) { return value.is_number(); }))
+        std::sort(elements.begin(), elements.end(), [](const lox::Value& a, const lox::Value& b) {
+            return !std::isnan(a.as_number()) and (std::isnan(b.as_number()) or a.as_number() < b.as_number());
+        });
+    else if (std::all_of(elements.begin(), elements.end(), [](const lox::Value& value) { return value.is_string(); }))
+        std::sort(elements.begin(), elements.end(), [](const lox::Value& a, const lox::Value& b) {
+            return a.as_string() < b.as_string();
+        });
+    else
+        throw lox::NativeError("Can only sort lists of numbers or of strings");
+    return {};
+}
+
+// a new list with the elements from start up to but not including end, start may not come after end
+lox::Value slice(lox::LoxList& list, lox::Arguments arguments) {
+    const size_t start = position(arguments[0], list.elements.size());
+    const size_t end   = position(arguments[1], list.elements.size());
+    if (start > end)
+        throw lox::NativeError("List slice start is after its end");
+    return lox::make_ref<lox::LoxList>(std::vector<lox::Value>(list.elements.begin() + start, list.elements.begin() + end));
+}
+
+};
+
+void lox::LoxList::trace(lox::Tracer& tracer) {
+    for (const Value& element : elements)
+        tracer(element);
+}
+
+void lox::LoxList::clear() {
+    elements.clear();
+}
+
+lox::Value& lox::LoxList::at(const lox::Value& index) {
+    const size_t slot = position(index, elements.size());
+    if (slot == elements.size())
+        throw NativeError("List index out of range");
+    return elements[slot];
+}
+
+lox::BuiltinMethod<lox::LoxList>* lox::LoxList::method(const lox::LoxString* name) {
+    static const SymbolMap<Ref<BuiltinMethod<LoxList>>> methods = [] {
+        SymbolMap<Ref<BuiltinMethod<LoxList>>> methods;
+        auto define = [&](const std::string& name, size_t params, Value (*function)(LoxList&, Arguments)) {
+            methods.emplace(LoxString::intern(name), make_ref<BuiltinMethod<LoxList>>("list." + name, params, function));
+        };
+        define("length", 0, length);
+        define("push", 1, push);
+        define("pop", 0, pop);
+        define("sort", 0, sort);
+        define("slice", 2, slice);
+        return methods;
+    }();
+    if (auto it = methods.find(name); it != methods.end())
+        return it->second.get();
+    return nullptr;
+}
@@ -0,0 +1,164 @@
+#include "lox_map.hpp"
+
+#include "lox_list.hpp"
+
+#include <bit>
+#include <cmath>
+
+namespace {
+
+constexpr size_t MIN_CAPACITY = 8;
+
+// grows once more than three quarters of the slots are taken, live or removed
+bool overloaded(const size_t used, const size_t capacity) {
+    return (used + 1) * 4 > capacity * 3;
+}
+
+// numbers are spread with the murmur3 finalizer, whole numbers would otherwise all land on the same low bits
+size_t hash(const lox::Value& key) {
+    if (key.is_string())
+        return key.as<lox::LoxString>()->hash;
+    if (key.is_number()) {
+        const double number = key.as_number();
+        if (std::isnan(number))
+            throw lox::NativeError("Map key cannot be NaN");
+        uint64_t bits = std::bit_cast<uint64_t>(number == 0 ? 0.0 : number); // -0 equals 0 and must hash like it
+        bits ^= bits >> 33;
+        bits *= 0xff51afd7ed558ccdull;
+        bits ^= bits >> 33;
+        bits *= 0xc4ceb9fe1a85ec53ull;
+        bits ^= bits >> 33;
+        return bits;
+    }
+    if (key.is_bool())
+        return key.as_bool() ? 0x9e3779b97f4a7c15ull : 0x7f4a7c159e3779b9ull;
+    throw lox::NativeError("Map key must be a string, a number or a boolean");
+}
+
+lox::Value length(lox::LoxMap& map, lox::Arguments) {
+    return static_cast<double>(map.size());
+}
+
+lox::Value has(lox::LoxMap& map, lox::Arguments arguments) {
+    return map.find(arguments[0]) != nullptr;
+}
+
+lox::Value remove_entry(lox::LoxMap& map, lox::Arguments arguments) {
+    return map.remove(arguments[0]);
+}
+
+lox::Value keys(lox::LoxMap& map, lox::Arguments) {
+    std::vector<lox::Value> keys;
+    keys.reserve(map.size());
+    map.for_each([&](const lox::Value& key, const lox::Value&) { keys.push_back(key); });
+    return lox::make_ref<lox::LoxList>(std::move(keys));
+}
+
+lox::Value values(lox::LoxMap& map, lox::Arguments) {
+    std::vector<lox::Value> values;
+    values.reserve(map.size());
+    map.for_each([&](const lox::Value&, const lox::Value& value) { values.push_back(value); });
+    return lox::make_ref<lox::LoxList>(std::move(values));
+}
+
+};
+
+void lox::LoxMap::trace(lox::Tracer& tracer) {
+    for (const Entry& entry : entries) {
+        tracer(entry.key);
+        tracer(entry.value);
+    }
+}
+
+void lox::LoxMap::clear() {
+    entries.clear();
+    count = used = 0;
+}
+
+// the slot holding the key, or else the slot it would go into: the first removed one passed or the empty one that ended
+// the probe. the table always has an empty slot, so the probe ends
+lox::LoxMap::Entry& lox::LoxMap::slot(const lox::Value& key, const size_t hash) {
+    const size_t mask    = entries.size() - 1;
+    Entry*       removed = nullptr;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        Entry& entry = entries[index];
+        if (entry.key.is_nil()) {
+            if (entry.value.is_nil())
+                return removed ? *removed : entry;
+            if (!removed)
+                removed = &entry;
+        } else if (entry.key == key)
+            return entry;
+    }
+}
+
+void lox::LoxMap::resize(const size_t capacity) {
+    std::vector<Entry> old = std::exchange(entries, std::vector<Entry>(capacity));
+    used                   = count;
+    for (Entry& entry : old)
+        if (!entry.key.is_nil()) {
+            const size_t key_hash = hash(entry.key);
+            slot(entry.key, key_hash) = std::move(entry);
+        }
+}
+
+void lox::LoxMap::reserve(const size_t size) {
+    size_t capacity = std::max(entries.size(), MIN_CAPACITY);
+    while (overloaded(size, capacity))
+        capacity *= 2;
+    if (capacity != entries.size())
+        resize(capacity);
+}
+
+lox::Value* lox::LoxMap::find(const lox::Value& key) {
+    const size_t key_hash = hash(key);
+    if (count == 0)
+        return nullptr;
+    Entry& entry = slot(key, key_hash);
+    return entry.key.is_nil() ? nullptr : &entry.value;
+}
+
+void lox::LoxMap::set(const lox::Value& key, lox::Value value) {
+    const size_t key_hash = hash(key);
+    if (overloaded(used, entries.size()))
+        resize(std::max(MIN_CAPACITY, std::bit_ceil((count + 1) * 2))); // also sweeps out removed entries
+    Entry& entry = slot(key, key_hash);
+    if (entry.key.is_nil()) {
+        count++;
+        if (entry.value.is_nil())
+            used++;
+        entry.key = key.is_number() and key.as_number() == 0 ? Value(0.0) : key;
+    }
+    entry.value = std::move(value);
+}
+
+bool lox::LoxMap::remove(const lox::Value& key) {
+    const size_t key_hash = hash(key);
+    if (count == 0)
+        return false;
+    Entry& entry = slot(key, key_hash);
+    if (entry.key.is_nil())
+        return false;
+    entry.key   = {};
+    entry.value = true;
+    count--;
+    return true;
+}
+
+lox::BuiltinMethod<lox::LoxMap>* lox::LoxMap::method(const lox::LoxString* name) {
+    static const SymbolMap<Ref<BuiltinMethod<LoxMap>>> methods = [] {
+        SymbolMap<Ref<BuiltinMethod<LoxMap>>> methods;
+        auto define = [&](const std::string& name, size_t params, Value (*function)(LoxMap&, Arguments)) {
+            methods.emplace(LoxString::intern(name), make_ref<BuiltinMethod<LoxMap>>("map." + name, params, function));
+        };
+        define("length", 0, length);
+        define("has", 1, has);
+        define("remove", 1, remove_entry);
+        define("keys", 0, keys);
+        define("values", 0, values);
+        return methods;
+    }();
+    if (auto it = methods.find(name); it != methods.end())
+        return it->second.get();
+    return nullptr;
+}
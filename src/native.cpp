@@ -0,0 +1,175 @@
+#include "native.hpp"
+
+#include "lox_class.hpp"
+#include "lox_instance.hpp"
+#include "lox_list.hpp"
+#include "lox_map.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <numbers>
+
+namespace {
+
+double seconds_since_epoch() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+double monotonic_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double cpu_seconds() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+double min(double a, double b) {
+    return std::min(a, b);
+}
+
+double max(double a, double b) {
+    return std::max(a, b);
+}
+
+double length(std::string_view string) {
+    return string.size();
+}
+
+// a position into a string, like a list index it has to be a whole number in [0, size]
+size_t position(double index, const size_t size, const char* function) {
+    if (index != std::floor(index))
+        throw lox::NativeError("Index " + std::to_string(index) + " is not a whole number in string." + function);
+    if (!(index >= 0 and index <= size))
+        throw lox::NativeError("Index " + std::to_string(index) + " out of range in string." + function);
+    return static_cast<size_t>(index);
+}
+
+lox::Value substring(std::string_view string, double start, double end) {
+    const size_t from = position(start, string.size(), "substring");
+    const size_t to   = position(end, string.size(), "substring");
+    if (from > to)
+        throw lox::NativeError("Start " + std::to_string(start) + " is after end " + std::to_string(end) + " in string.substring");
+    return string.substr(from, to - from);
+}
+
+lox::Value char_at(std::string_view string, double index) {
+    if (index == string.size())
+        throw lox::NativeError("Index " + std::to_string(index) + " out of range in string.char_at");
+    return string.substr(position(index, string.size(), "char_at"), 1);
+}
+
+double index_of(std::string_view string, std::string_view needle) {
+    const size_t found = string.find(needle);
+    return found == std::string_view::npos ? -1 : static_cast<double>(found);
+}
+
+lox::Value upper(std::string_view string) {
+    std::string result(string);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char ch) { return std::toupper(ch); });
+    return result;
+}
+
+lox::Value lower(std::string_view string) {
+    std::string result(string);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char ch) { return std::tolower(ch); });
+    return result;
+}
+
+// nil unless the whole string is a number. from_chars also takes nan and inf, which lox has no literals for, so the
+// string has to start with a digit or a minus and a digit
+lox::Value parse_number(std::string_view string) {
+    const size_t digit = string.starts_with('-') ? 1 : 0;
+    if (string.size() <= digit or !std::isdigit(static_cast<unsigned char>(string[digit])))
+        return {};
+    double number;
+    auto [end, error] = std::from_chars(string.data(), string.data() + string.size(), number);
+    if (error != std::errc() or end != string.data() + string.size())
+        return {};
+    return number;
+}
+
+};
+
+void lox::BoundBuiltinMethod::trace(lox::Tracer& tracer) {
+    tracer(receiver);
+}
+
+void lox::BoundBuiltinMethod::clear() {
+    receiver = {};
+}
+
+size_t lox::BoundBuiltinMethod::arity() {
+    return method->arity();
+}
+
+lox::Value lox::BoundBuiltinMethod::call(lox::Interpreter& interpreter, lox::Arguments arguments) {
+    return method->call_method(interpreter, receiver, arguments);
+}
+
+std::string lox::BoundBuiltinMethod::to_string() const {
+    return method->to_string();
+}
+
+lox::LoxCallable* lox::builtin_method(const lox::Value& receiver, const lox::LoxString* name) {
+    if (receiver.is_list())
+        return LoxList::method(name);
+    if (receiver.is_map())
+        return LoxMap::method(name);
+    return nullptr;
+}
+
+lox::Module::Module(std::string name) : name(std::move(name)) {
+    auto klass    = make_ref<LoxClass>(this->name, SymbolMap<Ref<LoxCallable>>{}, nullptr);
+    klass->frozen = true; // constant() fills the fields in directly
+    instance      = make_ref<LoxInstance>(std::move(klass));
+}
+
+void lox::Module::constant(std::string_view constant_name, lox::Value value) {
+    InlineCache cache; // a module is only built once, caching its shape would not pay off
+    instance->set_field(LoxString::intern(constant_name).get(), std::move(value), cache);
+}
+
+void lox::Module::define(lox::GlobalEnvironment& globals) {
+    globals.define(LoxString::intern(name), instance);
+}
+
+void lox::define_natives(lox::GlobalEnvironment& globals) {
+    globals.define(LoxString::intern("clock"), make_native("clock", seconds_since_epoch));
+
+    Module math("math");
+    math.function("sqrt", +[](double x) { return std::sqrt(x); })
+        .function("pow", +[](double x, double y) { return std::pow(x, y); })
+        .function("abs", +[](double x) { return std::fabs(x); })
+        .function("floor", +[](double x) { return std::floor(x); })
+        .function("ceil", +[](double x) { return std::ceil(x); })
+        .function("round", +[](double x) { return std::round(x); })
+        .function("sin", +[](double x) { return std::sin(x); })
+        .function("cos", +[](double x) { return std::cos(x); })
+        .function("tan", +[](double x) { return std::tan(x); })
+        .function("atan2", +[](double y, double x) { return std::atan2(y, x); })
+        .function("exp", +[](double x) { return std::exp(x); })
+        .function("log", +[](double x) { return std::log(x); })
+        .function("min", min)
+        .function("max", max);
+    math.constant("pi", std::numbers::pi);
+    math.constant("e", std::numbers::e);
+    math.define(globals);
+
+    Module string("string");
+    string.function("length", length)
+        .function("substring", substring)
+        .function("char_at", char_at)
+        .function("index_of", index_of)
+        .function("upper", upper)
+        .function("lower", lower)
+        .function("parse_number", parse_number);
+    string.define(globals);
+
+    Module time("time");
+    time.function("now", seconds_since_epoch).function("monotonic", monotonic_seconds).function("cpu", cpu_seconds);
+    time.define(globals);
+}
@@ -0,0 +1,165 @@
+#include "object.hpp"
+
+#include "value.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+constexpr int64_t UNREACHABLE = -1;
+
+// every reference between two objects of the collected generations is taken off the target's count, whatever is
+// left over was made from outside
+class Subtract : public lox::Tracer {
+
+    const int generation;
+
+public:
+    Subtract(const int generation) : generation(generation) {}
+
+    void visit(lox::Object* object) override {
+        if (object->generation <= generation)
+            object->gc_refs--;
+    }
+};
+
+// anything a reachable object points at is reachable too. objects already moved to the unreachable list go back to
+// the end of the young list, so the scan still gets to them
+class Reach : public lox::Tracer {
+
+    const int     generation;
+    lox::GcNode& young;
+
+public:
+    Reach(const int generation, lox::GcNode& young) : generation(generation), young(young) {}
+
+    void visit(lox::Object* object) override {
+        if (object->generation > generation)
+            return;
+        if (object->gc_refs == UNREACHABLE) {
+            object->unlink();
+            young.append(object);
+            object->gc_refs = 1;
+        } else if (object->gc_refs == 0)
+            object->gc_refs = 1;
+    }
+};
+
+void splice(lox::GcNode& from, lox::GcNode& to) {
+    if (&from == &to or from.next == &from)
+        return;
+    from.next->prev = to.prev;
+    to.prev->next   = from.next;
+    from.prev->next = &to;
+    to.prev         = from.prev;
+    from.prev = from.next = &from;
+}
+
+};
+
+lox::Object::Object(const lox::ObjectType type) : type(type) {
+    Heap& heap = lox::heap();
+    heap.allocated[static_cast<size_t>(type)]++;
+    heap.peak_live = std::max(heap.peak_live, ++heap.live);
+    if (traced())
+        heap.track(this);
+}
+
+lox::Object::~Object() {
+    heap().live--;
+    if (traced())
+        heap().untrack(this);
+}
+
+void lox::Heap::track(lox::Object* object) {
+    generations[0].append(object);
+    tracked++;
+    if (++counts[0] > thresholds[0] and enabled and !collecting)
+        due = true;
+}
+
+void lox::Heap::untrack(lox::Object* object) {
+    object->unlink();
+    tracked--;
+    if (counts[0] > 0)
+        counts[0]--;
+}
+
+void lox::Heap::collect_due() {
+    due = false;
+    for (int generation = GENERATIONS - 1; generation >= 0; generation--)
+        if (counts[generation] > thresholds[generation]) {
+            collect(generation);
+            return;
+        }
+}
+
+void lox::Heap::collect(const int generation) {
+    if (collecting)
+        return;
+    collecting = true;
+    const auto start = std::chrono::steady_clock::now();
+
+    GcNode& young = generations[generation];
+    for (int younger = 0; younger < generation; younger++)
+        splice(generations[younger], young);
+    for (GcNode* node = young.next; node != &young; node = node->next) {
+        Object* object  = static_cast<Object*>(node);
+        object->gc_refs = object->refs;
+    }
+    Subtract subtract(generation);
+    for (GcNode* node = young.next; node != &young; node = node->next)
+        static_cast<Object*>(node)->trace(subtract);
+
+    // objects are only moved to the unreachable list once the scan reaches them, by then every root before them has
+    // already vouched for what it points at
+    GcNode unreachable;
+    Reach  reach(generation, young);
+    for (GcNode* node = young.next; node != &young;) {
+        Object* object = static_cast<Object*>(node);
+        if (object->gc_refs > 0) {
+            object->trace(reach);
+            node = node->next;
+            continue;
+        }
+        node = node->next;
+        object->unlink();
+        unreachable.append(object);
+        object->gc_refs = UNREACHABLE;
+    }
+
+    const int older = std::min(generation + 1, GENERATIONS - 1);
+    for (GcNode* node = young.next; node != &young; node = node->next)
+        static_cast<Object*>(node)->generation = older;
+    splice(young, generations[older]);
+
+    // the garbage is held while its references are dropped so nothing is freed halfway through breaking the cycles
+    std::vector<Ref<Object>> garbage;
+    for (GcNode* node = unreachable.next; node != &unreachable; node = node->next)
+        garbage.emplace_back(static_cast<Object*>(node));
+    for (Ref<Object>& object : garbage)
+        object->clear();
+    const size_t found = garbage.size();
+    garbage.clear();
+    size_t survivors = 0;
+    for (GcNode* node = unreachable.next; node != &unreachable; node = node->next) {
+        static_cast<Object*>(node)->generation = older;
+        survivors++;
+    }
+    splice(unreachable, generations[older]);
+
+    for (int younger = 0; younger <= generation; younger++)
+        counts[younger] = 0;
+    if (generation + 1 < GENERATIONS)
+        counts[generation + 1]++;
+
+    const double pause = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    GcStats&     stat  = stats[generation];
+    stat.collections++;
+    stat.freed += found - survivors;
+    stat.total_pause += pause;
+    stat.max_pause = std::max(stat.max_pause, pause);
+    collecting     = false;
+}
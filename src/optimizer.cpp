@@ -0,0 +1,452 @@
+#include "optimizer.hpp"
+
+#include <utility>
+
+namespace {
+
+// sizes a program before and after optimizing it
+struct NodeCounter : lox::ExprVisitor, lox::StmtVisitor {
+    size_t nodes = 0;
+
+    void count(const std::unique_ptr<lox::Expr>& expr) {
+        if (expr)
+            expr->accept(*this);
+    }
+
+    void count(const std::unique_ptr<lox::Stmt>& stmt) {
+        if (stmt)
+            stmt->accept(*this);
+    }
+
+    void count(const std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+        for (const auto& statement : statements)
+            count(statement);
+    }
+
+    void visit(lox::BlockStmt& stmt) override {
+        nodes++;
+        count(stmt.statements);
+    }
+
+    void visit(lox::ClassStmt& stmt) override {
+        nodes++;
+        for (const auto& method : stmt.methods)
+            visit(*method);
+        if (stmt.superclass)
+            visit(*stmt.superclass);
+    }
+
+    void visit(lox::ExprStmt& stmt) override {
+        nodes++;
+        count(stmt.expr);
+    }
+
+    void visit(lox::FnStmt& stmt) override {
+        nodes++;
+        count(stmt.body);
+    }
+
+    void visit(lox::IfStmt& stmt) override {
+        nodes++;
+        count(stmt.condition);
+        count(stmt.then);
+        count(stmt.otherwise);
+    }
+
+    void visit(lox::PrintStmt& stmt) override {
+        nodes++;
+        count(stmt.expr);
+    }
+
+    void visit(lox::ReturnStmt& stmt) override {
+        nodes++;
+        count(stmt.value);
+    }
+
+    void visit(lox::VarStmt& stmt) override {
+        nodes++;
+        count(stmt.initializer);
+    }
+
+    void visit(lox::WhileStmt& stmt) override {
+        nodes++;
+        count(stmt.condition);
+        count(stmt.body);
+    }
+
+    lox::Value visit(lox::AssignExpr& expr) override {
+        nodes++;
+        count(expr.value);
+        return {};
+    }
+
+    lox::Value visit(lox::BinaryExpr& expr) override {
+        nodes++;
+        count(expr.left);
+        count(expr.right);
+        return {};
+    }
+
+    lox::Value visit(lox::CallExpr& expr) override {
+        nodes++;
+        count(expr.callee);
+        for (const auto& argument : expr.arguments)
+            count(argument);
+        return {};
+    }
+
+    lox::Value visit(lox::GetExpr& expr) override {
+        nodes++;
+        count(expr.object);
+        return {};
+    }
+
+    lox::Value visit(lox::GroupingExpr& expr) override {
+        nodes++;
+        count(expr.expr);
+        return {};
+    }
+
+    lox::Value visit(lox::IndexExpr& expr) override {
+        nodes++;
+        count(expr.object);
+        count(expr.index);
+        return {};
+    }
+
+    lox::Value visit(lox::IndexSetExpr& expr) override {
+        nodes++;
+        count(expr.object);
+        count(expr.index);
+        count(expr.value);
+        return {};
+    }
+
+    lox::Value visit(lox::ListExpr& expr) override {
+        nodes++;
+        for (const auto& element : expr.elements)
+            count(element);
+        return {};
+    }
+
+    lox::Value visit(lox::LiteralExpr&) override {
+        nodes++;
+        return {};
+    }
+
+    lox::Value visit(lox::LogicalExpr& expr) override {
+        nodes++;
+        count(expr.left);
+        count(expr.right);
+        return {};
+    }
+
+    lox::Value visit(lox::MapExpr& expr) override {
+        nodes++;
+        for (size_t i = 0; i < expr.keys.size(); i++) {
+            count(expr.keys[i]);
+            count(expr.values[i]);
+        }
+        return {};
+    }
+
+    lox::Value visit(lox::SetExpr& expr) override {
+        nodes++;
+        count(expr.object);
+        count(expr.value);
+        return {};
+    }
+
+    lox::Value visit(lox::SuperExpr&) override {
+        nodes++;
+        return {};
+    }
+
+    lox::Value visit(lox::ThisExpr&) override {
+        nodes++;
+        return {};
+    }
+
+    lox::Value visit(lox::UnaryExpr& expr) override {
+        nodes++;
+        count(expr.right);
+        return {};
+    }
+
+    lox::Value visit(lox::VariableExpr&) override {
+        nodes++;
+        return {};
+    }
+};
+
+size_t size(const std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    NodeCounter counter;
+    counter.count(statements);
+    return counter.nodes;
+}
+
+lox::LiteralExpr* literal(const std::unique_ptr<lox::Expr>& expr) {
+    return dynamic_cast<lox::LiteralExpr*>(expr.get());
+}
+
+};
+
+size_t lox::Optimizer::optimize(std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    const size_t before = size(statements);
+    optimize_all(statements);
+    return before - size(statements);
+}
+
+void lox::Optimizer::optimize(std::unique_ptr<lox::Expr>& expr) {
+    expr->accept(*this);
+    if (folded)
+        expr = std::move(folded);
+}
+
+void lox::Optimizer::optimize(std::unique_ptr<lox::Stmt>& stmt) {
+    stmt->accept(*this);
+    if (pruned)
+        stmt = std::move(pruned);
+    else if (std::exchange(removed, false)) {
+        // a single statement slot (a branch or loop body) keeps an empty block, which makes no environment
+        auto empty    = std::make_unique<BlockStmt>(std::vector<std::unique_ptr<Stmt>>{});
+        empty->line   = stmt->line;
+        empty->framed = true;
+        stmt          = std::move(empty);
+    }
+}
+
+void lox::Optimizer::optimize_all(std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    for (auto& statement : statements) {
+        statement->accept(*this);
+        if (pruned)
+            statement = std::move(pruned);
+        else if (std::exchange(removed, false))
+            statement = nullptr;
+    }
+    std::erase(statements, nullptr);
+}
+
+void lox::Optimizer::visit(lox::BlockStmt& stmt) {
+    optimize_all(stmt.statements);
+}
+
+void lox::Optimizer::visit(lox::ClassStmt& stmt) {
+    for (auto& method : stmt.methods)
+        visit(*method);
+}
+
+// an expression statement without side effects does nothing
+void lox::Optimizer::visit(lox::ExprStmt& stmt) {
+    optimize(stmt.expr);
+    removed = literal(stmt.expr) != nullptr;
+}
+
+void lox::Optimizer::visit(lox::FnStmt& stmt) {
+    optimize_all(stmt.body);
+}
+
+// an if statement only introduces a scope through its branches, so it can be replaced by the branch that runs
+void lox::Optimizer::visit(lox::IfStmt& stmt) {
+    optimize(stmt.condition);
+    optimize(stmt.then);
+    if (stmt.otherwise)
+        optimize(stmt.otherwise);
+    if (LiteralExpr* condition = literal(stmt.condition)) {
+        if (interpreter.is_truthy(condition->value))
+            pruned = std::move(stmt.then);
+        else if (stmt.otherwise)
+            pruned = std::move(stmt.otherwise);
+        else
+            removed = true;
+    }
+}
+
+void lox::Optimizer::visit(lox::PrintStmt& stmt) {
+    optimize(stmt.expr);
+}
+
+void lox::Optimizer::visit(lox::ReturnStmt& stmt) {
+    if (stmt.value)
+        optimize(stmt.value);
+}
+
+void lox::Optimizer::visit(lox::VarStmt& stmt) {
+    if (stmt.initializer)
+        optimize(stmt.initializer);
+}
+
+void lox::Optimizer::visit(lox::WhileStmt& stmt) {
+    optimize(stmt.condition);
+    optimize(stmt.body);
+    if (LiteralExpr* condition = literal(stmt.condition); condition and !interpreter.is_truthy(condition->value))
+        removed = true;
+}
+
+lox::Value lox::Optimizer::visit(lox::AssignExpr& expr) {
+    optimize(expr.value);
+    return {};
+}
+
+// only operations that cannot fail are folded, anything else is left to raise its error at runtime
+lox::Value lox::Optimizer::visit(lox::BinaryExpr& expr) {
+    optimize(expr.left);
+    optimize(expr.right);
+    LiteralExpr* left  = literal(expr.left);
+    LiteralExpr* right = literal(expr.right);
+    if (!left or !right)
+        return {};
+    const Value& l = left->value;
+    const Value& r = right->value;
+    Value        value;
+    switch (expr.op.type) {
+    case BANG_EQUAL:
+        value = !interpreter.is_equal(l, r);
+        break;
+    case EQUAL_EQUAL:
+        value = interpreter.is_equal(l, r);
+        break;
+    case PLUS:
+        if (l.is_number() and r.is_number())
+            value = l.as_number() + r.as_number();
+        else if (l.is_string() or r.is_string())
+            value = interpreter.stringfy(l) + interpreter.stringfy(r);
+        else
+            return {};
+        break;
+    case MINUS:
+    case STAR:
+    case SLASH:
+    case GREATER:
+    case GREATER_EQUAL:
+    case LESSER:
+    case LESSER_EQUAL: {
+        if (!l.is_number() or !r.is_number())
+            return {};
+        const double a = l.as_number();
+        const double b = r.as_number();
+        switch (expr.op.type) {
+        case MINUS:
+            value = a - b;
+            break;
+        case STAR:
+            value = a * b;
+            break;
+        case SLASH:
+            value = a / b;
+            break;
+        case GREATER:
+            value = a > b;
+            break;
+        case GREATER_EQUAL:
+            value = a >= b;
+            break;
+        case LESSER:
+            value = a < b;
+            break;
+        default:
+            value = a <= b;
+            break;
+        }
+        break;
+    }
+    default:
+        return {};
+    }
+    folded = std::make_unique<LiteralExpr>(std::move(value));
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::CallExpr& expr) {
+    optimize(expr.callee);
+    for (auto& argument : expr.arguments)
+        optimize(argument);
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::GetExpr& expr) {
+    optimize(expr.object);
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::GroupingExpr& expr) {
+    optimize(expr.expr);
+    folded = std::move(expr.expr);
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::IndexExpr& expr) {
+    optimize(expr.object);
+    optimize(expr.index);
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::IndexSetExpr& expr) {
+    optimize(expr.object);
+    optimize(expr.index);
+    optimize(expr.value);
+    return {};
+}
+
+// never folded, even with literal elements, since every evaluation has to build a new list
+lox::Value lox::Optimizer::visit(lox::ListExpr& expr) {
+    for (auto& element : expr.elements)
+        optimize(element);
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::LiteralExpr&) {
+    return {};
+}
+
+// a literal left operand decides on its own which operand the expression evaluates to
+lox::Value lox::Optimizer::visit(lox::LogicalExpr& expr) {
+    optimize(expr.left);
+    optimize(expr.right);
+    if (LiteralExpr* left = literal(expr.left)) {
+        const bool truthy = interpreter.is_truthy(left->value);
+        if (truthy == (expr.op.type == OR))
+            folded = std::move(expr.left);
+        else
+            folded = std::move(expr.right);
+    }
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::MapExpr& expr) {
+    for (size_t i = 0; i < expr.keys.size(); i++) {
+        optimize(expr.keys[i]);
+        optimize(expr.values[i]);
+    }
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::SetExpr& expr) {
+    optimize(expr.object);
+    optimize(expr.value);
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::SuperExpr&) {
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::ThisExpr&) {
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::UnaryExpr& expr) {
+    optimize(expr.right);
+    LiteralExpr* right = literal(expr.right);
+    if (!right)
+        return {};
+    if (expr.op.type == BANG)
+        folded = std::make_unique<LiteralExpr>(!interpreter.is_truthy(right->value));
+    else if (right->value.is_number())
+        folded = std::make_unique<LiteralExpr>(-right->value.as_number());
+    return {};
+}
+
+lox::Value lox::Optimizer::visit(lox::VariableExpr&) {
+    return {};
+}
@@ -18,6 +18,8 @@ std::unique_ptr<lox::Expr> lox::Parser::assignment() {
         }
         if (auto* get = dynamic_cast<GetExpr*>(expr.get()); get)
             return std::make_unique<SetExpr>(std::move(get->object), std::move(value), get->name);
+        if (auto* index = dynamic_cast<IndexExpr*>(expr.get()); index)
+            return std::make_unique<IndexSetExpr>(std::move(index->object), index->bracket, std::move(index->index), std::move(value));
         throw error(equal, "Invalid Assignment Target");
     }
     return expr;
@@ -100,6 +102,11 @@ std::unique_ptr<lox::Expr> lox::Parser::call() {
         } else if (match({DOT})) {
             const Token& name = consume(IDENTIFIER, "Expected property name after '.'.");
             expr              = std::make_unique<GetExpr>(std::move(expr), name);
+        } else if (match({LEFT_BRACKET})) {
+            const Token&          bracket = previous();
+            std::unique_ptr<Expr> index   = expression();
+            consume(RIGHT_BRACKET, "Expected ']' after index");
+            expr = std::make_unique<IndexExpr>(std::move(expr), bracket, std::move(index));
         } else {
             break;
         }
@@ -115,8 +122,10 @@ std::unique_ptr<lox::Expr> lox::Parser::finish_call(std::unique_ptr<lox::Expr> c
                 error(peek(), "Can't have more than 255 arguments");
             arguments.emplace_back(expression());
         } while (match({COMMA}));
-    const Token& paren = consume(RIGHT_PAREN, "Expected '(' after arguments");
-    return std::make_unique<CallExpr>(std::move(callee), paren, std::move(arguments));
+    const Token& paren  = consume(RIGHT_PAREN, "Expected '(' after arguments");
+    GetExpr*     method = dynamic_cast<GetExpr*>(callee.get());
+    SuperExpr*   super  = dynamic_cast<SuperExpr*>(callee.get());
+    return std::make_unique<CallExpr>(std::move(callee), paren, std::move(arguments), method, super);
 }
 
 std::unique_ptr<lox::Expr> lox::Parser::primary() {
@@ -135,6 +144,29 @@ std::unique_ptr<lox::Expr> lox::Parser::primary() {
         consume(RIGHT_PAREN, "Expected ')' after expression ");
         return std::make_unique<GroupingExpr>(std::move(expr));
     }
+    if (match({LEFT_BRACKET})) {
+        const Token&                       bracket  = previous();
+        std::vector<std::unique_ptr<Expr>> elements = std::vector<std::unique_ptr<Expr>>();
+        if (!check(RIGHT_BRACKET))
+            do
+                elements.emplace_back(expression());
+            while (match({COMMA}));
+        consume(RIGHT_BRACKET, "Expected ']' after list elements");
+        return std::make_unique<ListExpr>(bracket, std::move(elements));
+    }
+    if (match({LEFT_CURLY})) {
+        const Token&                       brace  = previous();
+        std::vector<std::unique_ptr<Expr>> keys   = std::vector<std::unique_ptr<Expr>>();
+        std::vector<std::unique_ptr<Expr>> values = std::vector<std::unique_ptr<Expr>>();
+        if (!check(RIGHT_CURLY))
+            do {
+                keys.emplace_back(expression());
+                consume(COLON, "Expected ':' after map key");
+                values.emplace_back(expression());
+            } while (match({COMMA}));
+        consume(RIGHT_CURLY, "Expected '}' after map entries");
+        return std::make_unique<MapExpr>(brace, std::move(keys), std::move(values));
+    }
     if (match({THIS}))
         return std::make_unique<ThisExpr>(previous());
     if (match({SUPER})) {
@@ -169,14 +201,19 @@ std::unique_ptr<lox::Stmt> lox::Parser::class_declaration() {
 }
 
 std::unique_ptr<lox::Stmt> lox::Parser::declaration() {
+    const unsigned line = peek().line;
     try {
+        std::unique_ptr<Stmt> stmt;
         if (match({CLASS}))
-            return class_declaration();
-        if (match({FUN}))
-            return function("function");
-        if (match({VAR}))
-            return var_declaration();
-        return statement();
+            stmt = class_declaration();
+        else if (match({FUN}))
+            stmt = function("function");
+        else if (match({VAR}))
+            stmt = var_declaration();
+        else
+            return statement();
+        stmt->line = line;
+        return stmt;
     } catch (const ParseError&) {
         synchronize();
         return {};
@@ -196,8 +233,10 @@ std::unique_ptr<lox::FnStmt> lox::Parser::function(const std::string& kind) {
     }
     consume(RIGHT_PAREN, "Expected ')' after parameters");
     consume(LEFT_CURLY, "Expected '{' before " + kind + " body");
-    std::vector<std::unique_ptr<Stmt>> body = block();
-    return std::make_unique<FnStmt>(name, std::move(params), std::move(body));
+    std::vector<std::unique_ptr<Stmt>> body     = block();
+    std::unique_ptr<FnStmt>            function = std::make_unique<FnStmt>(name, std::move(params), std::move(body));
+    function->line                              = name.line;
+    return function;
 }
 
 std::unique_ptr<lox::Stmt> lox::Parser::var_declaration() {
@@ -208,19 +247,24 @@ std::unique_ptr<lox::Stmt> lox::Parser::var_declaration() {
 }
 
 std::unique_ptr<lox::Stmt> lox::Parser::statement() {
+    const unsigned        line = peek().line;
+    std::unique_ptr<Stmt> stmt;
     if (match({PRINT}))
-        return print_statement();
-    if (match({LEFT_CURLY}))
-        return std::make_unique<BlockStmt>(block());
-    if (match({IF}))
-        return if_statement();
-    if (match({WHILE}))
-        return while_statement();
-    if (match({FOR}))
-        return for_statement();
-    if (match({RETURN}))
-        return return_statement();
-    return expression_statement();
+        stmt = print_statement();
+    else if (match({LEFT_CURLY}))
+        stmt = std::make_unique<BlockStmt>(block());
+    else if (match({IF}))
+        stmt = if_statement();
+    else if (match({WHILE}))
+        stmt = while_statement();
+    else if (match({FOR}))
+        stmt = for_statement();
+    else if (match({RETURN}))
+        stmt = return_statement();
+    else
+        stmt = expression_statement();
+    stmt->line = line;
+    return stmt;
 }
 
 std::vector<std::unique_ptr<lox::Stmt>> lox::Parser::block() {
@@ -231,7 +275,9 @@ std::vector<std::unique_ptr<lox::Stmt>> lox::Parser::block() {
     return std::move(statements);
 }
 
+// the statements a for loop is desugared into all report the line of the loop
 std::unique_ptr<lox::Stmt> lox::Parser::for_statement() {
+    const unsigned line = previous().line;
     consume(LEFT_PAREN, "Expected '(' after for");
     std::unique_ptr<Stmt> init;
     if (match({SEMICOLON}))
@@ -253,10 +299,14 @@ std::unique_ptr<lox::Stmt> lox::Parser::for_statement() {
         std::vector<std::unique_ptr<Stmt>> loop_stmts;
         loop_stmts.emplace_back(std::move(body));
         loop_stmts.emplace_back(std::make_unique<ExprStmt>(std::move(update)));
-        body = std::make_unique<BlockStmt>(std::move(loop_stmts));
+        loop_stmts.back()->line = line;
+        body                    = std::make_unique<BlockStmt>(std::move(loop_stmts));
+        body->line              = line;
     }
-    body = std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    body       = std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+    body->line = line;
     if (init) {
+        init->line = line;
         std::vector<std::unique_ptr<Stmt>> block;
         block.emplace_back(std::move(init));
         block.emplace_back(std::move(body));
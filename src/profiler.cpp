@@ -0,0 +1,96 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace {
+
+constexpr size_t REPORTED_LINES = 20;
+
+double milliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+};
+
+lox::Profiler::Profiler() {
+    functions.push_back({"<script>", 1});
+    nodes.push_back({0});
+}
+
+void lox::Profiler::enter(const void* key, std::string_view name, const unsigned line, Object* pin) {
+    auto [it, inserted] = index.try_emplace(key, functions.size());
+    if (inserted) {
+        functions.push_back({line ? std::string(name) + ":" + std::to_string(line) : std::string(name)});
+        if (pin)
+            pinned.emplace_back(pin);
+    }
+    const size_t function = it->second;
+    const size_t parent   = frames.empty() ? 0 : frames.back().node;
+    auto [child, added]   = nodes[parent].children.try_emplace(function, nodes.size());
+    const size_t node     = child->second;
+    if (added)
+        nodes.push_back({function});
+    functions[function].calls++;
+    functions[function].active++;
+    frames.push_back({function, node, Clock::now()});
+}
+
+void lox::Profiler::exit() {
+    const Frame           frame     = frames.back();
+    const Clock::duration inclusive = Clock::now() - frame.start;
+    const Clock::duration self      = inclusive - frame.children;
+    frames.pop_back();
+    Function& function = functions[frame.function];
+    function.self += self;
+    if (--function.active == 0)
+        function.inclusive += inclusive;
+    nodes[frame.node].self += self;
+    if (frames.empty())
+        called += inclusive;
+    else
+        frames.back().children += inclusive;
+}
+
+void lox::Profiler::report(std::ostream& out) const {
+    const Clock::duration total  = Clock::now() - start;
+    std::vector<Function> sorted = functions;
+    sorted[0].self               = total - called;
+    sorted[0].inclusive          = total;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Function& a, const Function& b) { return a.self > b.self; });
+
+    out << std::fixed << std::setprecision(3);
+    out << "[profile] " << std::setw(10) << "calls" << std::setw(14) << "self ms" << std::setw(14) << "total ms"
+        << "  function\n";
+    for (const Function& function : sorted)
+        out << "[profile] " << std::setw(10) << function.calls << std::setw(14) << milliseconds(function.self) << std::setw(14)
+            << milliseconds(function.inclusive) << "  " << function.name << "\n";
+
+    std::vector<size_t> hot(lines.size());
+    std::iota(hot.begin(), hot.end(), 0);
+    std::stable_sort(hot.begin(), hot.end(), [this](size_t a, size_t b) { return lines[a] > lines[b]; });
+    out << "[profile] " << std::setw(10) << "hits" << "  line\n";
+    for (size_t i = 0; i < hot.size() and i < REPORTED_LINES and lines[hot[i]] > 0; i++)
+        out << "[profile] " << std::setw(10) << lines[hot[i]] << "  " << hot[i] << "\n";
+}
+
+void lox::Profiler::write_folded(std::ostream& out, const Node& node, std::string& stack) const {
+    const size_t length = stack.size();
+    if (!stack.empty())
+        stack += ';';
+    stack += functions[node.function].name;
+    Clock::duration self = node.self;
+    if (&node == &nodes[0])
+        self = Clock::now() - start - called;
+    if (const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(self).count(); micros > 0)
+        out << stack << " " << micros << "\n";
+    for (const auto& [function, child] : node.children)
+        write_folded(out, nodes[child], stack);
+    stack.resize(length);
+}
+
+void lox::Profiler::write_folded(std::ostream& out) const {
+    std::string stack;
+    write_folded(out, nodes[0], stack);
+}
@@ -2,6 +2,45 @@
 
 #include "error.hpp"
 
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// a function declared inside another one closes over its scope, a class does the same through its methods
+bool declares_closures(const std::vector<std::unique_ptr<lox::Stmt>>&);
+
+bool declares_closures(const lox::Stmt* stmt) {
+    if (stmt == nullptr)
+        return false;
+    if (dynamic_cast<const lox::FnStmt*>(stmt) or dynamic_cast<const lox::ClassStmt*>(stmt))
+        return true;
+    if (auto block = dynamic_cast<const lox::BlockStmt*>(stmt))
+        return declares_closures(block->statements);
+    if (auto branch = dynamic_cast<const lox::IfStmt*>(stmt))
+        return declares_closures(branch->then.get()) or declares_closures(branch->otherwise.get());
+    if (auto loop = dynamic_cast<const lox::WhileStmt*>(stmt))
+        return declares_closures(loop->body.get());
+    return false;
+}
+
+bool declares_closures(const std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    for (const auto& statement : statements)
+        if (declares_closures(statement.get()))
+            return true;
+    return false;
+}
+
+bool declares_variables(const std::vector<std::unique_ptr<lox::Stmt>>& statements) {
+    for (const auto& statement : statements)
+        if (dynamic_cast<const lox::VarStmt*>(statement.get()) or dynamic_cast<const lox::FnStmt*>(statement.get())
+            or dynamic_cast<const lox::ClassStmt*>(statement.get()))
+            return true;
+    return false;
+}
+
+};
+
 void lox::Resolver::resolve(const std::unique_ptr<lox::VariableExpr>& expr) {
     expr->accept(*this);
 }
@@ -14,50 +53,90 @@ void lox::Resolver::resolve(const std::unique_ptr<lox::Stmt>& stmt) {
     stmt->accept(*this);
 }
 
-void lox::Resolver::resolve_function(const lox::FnStmt& stmt, const lox::Resolver::FunctionType type) {
+// nothing can capture the locals of a function that declares no function or class, they are given frame slots instead
+void lox::Resolver::resolve_function(lox::FnStmt& stmt, const lox::Resolver::FunctionType type) {
     FunctionType enclosing_function = current_function;
     current_function                = type;
+    const bool enclosing_framing    = std::exchange(framing, !declares_closures(stmt.body));
+    const int  enclosing_slots      = std::exchange(frame_slots, 0);
+    const int  enclosing_size       = std::exchange(frame_size, 0);
     begin_scope();
+    if (type == FunctionType::METHOD or type == FunctionType::INITIALIZER) {
+        declare("this");
+        define("this");
+    }
     for (const Token& param : stmt.params) {
         declare(param);
         define(param);
     }
     resolve(stmt.body);
-    end_scope();
+    const int slots  = end_scope();
+    stmt.framed      = framing;
+    stmt.slots       = framing ? frame_size : slots;
     current_function = enclosing_function;
+    framing          = enclosing_framing;
+    frame_slots      = enclosing_slots;
+    frame_size       = enclosing_size;
 }
 
-void lox::Resolver::resolve_local(lox::Expr& expr, const Token& name) {
+// framed scopes have no environment at runtime, so they don't count towards the depth
+void lox::Resolver::resolve_local(lox::Local& local, std::string_view name) {
+    int depth = 0;
     for (int i = scopes.size() - 1; i >= 0; i--) {
-        if (scopes[i].contains(name.lexeme)) {
-            interpreter.resolve(&expr, scopes.size() - i - 1);
+        if (auto it = scopes[i].variables.find(name); it != scopes[i].variables.end()) {
+            local = {scopes[i].framed ? Local::FRAME : depth, it->second.slot};
             return;
         }
+        if (!scopes[i].framed)
+            depth++;
     }
 }
 
 void lox::Resolver::begin_scope() {
     scopes.emplace_back();
+    scopes.back().framed = framing;
 }
 
-void lox::Resolver::end_scope() {
+int lox::Resolver::end_scope() {
+    const int slots = scopes.back().slots;
+    if (scopes.back().framed)
+        frame_slots -= slots;
     scopes.pop_back();
+    return slots;
 }
 
 void lox::Resolver::declare(const lox::Token& name) {
-    if (!scopes.empty())
-        scopes.back()[name.lexeme] = false;
+    declare(name.lexeme);
+}
+
+void lox::Resolver::declare(std::string_view name) {
+    if (scopes.empty())
+        return;
+    Scope& scope = scopes.back();
+    if (scope.framed) {
+        scope.variables[name] = {false, frame_slots++};
+        scope.slots++;
+        frame_size = std::max(frame_size, frame_slots);
+    } else
+        scope.variables[name] = {false, scope.slots++};
 }
 
 void lox::Resolver::define(const lox::Token& name) {
+    define(name.lexeme);
+}
+
+void lox::Resolver::define(std::string_view name) {
     if (!scopes.empty())
-        scopes.back()[name.lexeme] = true;
+        scopes.back().variables[name].defined = true;
 }
 
+// a block that declares nothing needs no environment either, wherever it is
 void lox::Resolver::visit(lox::BlockStmt& stmt) {
     begin_scope();
+    scopes.back().framed = framing or !declares_variables(stmt.statements);
     resolve(stmt.statements);
-    end_scope();
+    stmt.framed = scopes.back().framed;
+    stmt.slots  = end_scope();
 }
 
 void lox::Resolver::visit(lox::ClassStmt& stmt) {
@@ -74,10 +153,9 @@ void lox::Resolver::visit(lox::ClassStmt& stmt) {
         }
     if (stmt.superclass) {
         begin_scope();
-        scopes.back()["super"] = true;
+        declare("super");
+        define("super");
     }
-    begin_scope();
-    scopes.back()["this"] = true;
     FunctionType declaration;
     for (const auto& method : stmt.methods) {
         if (method->name.lexeme == "init")
@@ -88,7 +166,6 @@ void lox::Resolver::visit(lox::ClassStmt& stmt) {
     }
     if (stmt.superclass)
         end_scope();
-    end_scope();
     current_class = enclosing_class;
 }
 
@@ -128,6 +205,7 @@ void lox::Resolver::visit(lox::VarStmt& stmt) {
     if (stmt.initializer)
         resolve(stmt.initializer);
     define(stmt.name);
+    resolve_local(stmt.local, stmt.name.lexeme);
 }
 
 void lox::Resolver::visit(lox::WhileStmt& stmt) {
@@ -137,7 +215,7 @@ void lox::Resolver::visit(lox::WhileStmt& stmt) {
 
 lox::Value lox::Resolver::visit(lox::AssignExpr& expr) {
     resolve(expr.value);
-    resolve_local(expr, expr.name);
+    resolve_local(expr.local, expr.name.lexeme);
     return {};
 }
 
@@ -164,11 +242,38 @@ lox::Value lox::Resolver::visit(lox::GroupingExpr& expr) {
     return {};
 }
 
+lox::Value lox::Resolver::visit(lox::IndexExpr& expr) {
+    resolve(expr.object);
+    resolve(expr.index);
+    return {};
+}
+
+lox::Value lox::Resolver::visit(lox::IndexSetExpr& expr) {
+    resolve(expr.object);
+    resolve(expr.index);
+    resolve(expr.value);
+    return {};
+}
+
+lox::Value lox::Resolver::visit(lox::ListExpr& expr) {
+    for (const auto& element : expr.elements)
+        resolve(element);
+    return {};
+}
+
 lox::Value lox::Resolver::visit(lox::LiteralExpr& expr) {
     // it's supposed to be empty
     return {};
 }
 
+lox::Value lox::Resolver::visit(lox::MapExpr& expr) {
+    for (size_t i = 0; i < expr.keys.size(); i++) {
+        resolve(expr.keys[i]);
+        resolve(expr.values[i]);
+    }
+    return {};
+}
+
 lox::Value lox::Resolver::visit(lox::LogicalExpr& expr) {
     resolve(expr.left);
     resolve(expr.right);
@@ -186,14 +291,15 @@ lox::Value lox::Resolver::visit(SuperExpr& expr) {
         error(expr.keyword, "Can't use 'super' outside of a class");
     else if (current_class != ClassType::SUBCLASS)
         error(expr.keyword, "Can't use 'super' in class with no subclass");
-    resolve_local(expr, expr.keyword);
+    resolve_local(expr.local, expr.keyword.lexeme);
+    resolve_local(expr.receiver, "this");
     return {};
 }
 
 lox::Value lox::Resolver::visit(ThisExpr& expr) {
     if (current_class == ClassType::NONE)
         error(expr.keyword, "Can't use this outside of a class");
-    resolve_local(expr, expr.keyword);
+    resolve_local(expr.local, expr.keyword.lexeme);
     return {};
 }
 
@@ -203,9 +309,12 @@ lox::Value lox::Resolver::visit(lox::UnaryExpr& expr) {
 }
 
 lox::Value lox::Resolver::visit(lox::VariableExpr& expr) {
-    if (!scopes.empty() and scopes.back().contains(expr.name.lexeme) and !scopes.back()[expr.name.lexeme])
-        error(expr.name, "Can't read local variable in its own initializer");
-    resolve_local(expr, expr.name);
+    if (!scopes.empty()) {
+        auto it = scopes.back().variables.find(expr.name.lexeme);
+        if (it != scopes.back().variables.end() and !it->second.defined)
+            error(expr.name, "Can't read local variable in its own initializer");
+    }
+    resolve_local(expr.local, expr.name.lexeme);
     return {};
 }
 
@@ -0,0 +1,153 @@
+#include "sampler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <numeric>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t REPORTED_LINES = 20;
+constexpr auto   DRAIN_PERIOD   = std::chrono::milliseconds(10);
+
+lox::Sampler* active = nullptr; // the one the signal handler records into
+
+std::string label(const lox::FnStmt* function) {
+    if (!function)
+        return "<script>";
+    return std::string(function->name.lexeme) + ":" + std::to_string(function->line);
+}
+
+};
+
+static_assert(std::atomic<size_t>::is_always_lock_free and std::atomic<unsigned>::is_always_lock_free,
+              "the signal handler cannot take locks");
+
+lox::Sampler::~Sampler() {
+    stop();
+}
+
+void lox::Sampler::tick(int) {
+    const int saved = errno;
+    if (active)
+        active->sample();
+    errno = saved;
+}
+
+// runs in the signal handler on the interpreter thread, so the shadow stack cannot change underneath it
+void lox::Sampler::sample() {
+    const size_t position = head.load(std::memory_order_relaxed);
+    if (position - tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::atomic_signal_fence(std::memory_order_acquire);
+    Sample&      sample = ring[position % RING_SIZE];
+    const size_t top    = std::min(depth.load(std::memory_order_relaxed), DEPTH - 1);
+    sample.depth        = top;
+    for (size_t i = 0; i < top; i++)
+        sample.functions[i] = frames[i + 1].function;
+    sample.line = frames[top].line.load(std::memory_order_relaxed);
+    head.store(position + 1, std::memory_order_release);
+}
+
+void lox::Sampler::drain() {
+    size_t       position = tail.load(std::memory_order_relaxed);
+    const size_t end      = head.load(std::memory_order_acquire);
+    for (; position != end; position++) {
+        const Sample& sample = ring[position % RING_SIZE];
+        stacks[std::vector<const FnStmt*>(sample.functions, sample.functions + sample.depth)]++;
+        if (sample.line >= lines.size())
+            lines.resize(sample.line + 1);
+        lines[sample.line]++;
+        samples++;
+    }
+    tail.store(position, std::memory_order_release);
+}
+
+bool lox::Sampler::start(const unsigned frequency) {
+    struct sigaction action = {};
+    action.sa_handler       = tick;
+    action.sa_flags         = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0)
+        return false;
+
+    // cpu time clocks only advance at the scheduler tick, a few hundred hertz at best, so the timer runs on the
+    // monotonic clock and time the interpreter spends blocked is sampled too. the signal goes to the interpreter alone
+    struct sigevent event        = {};
+    event.sigev_notify           = SIGEV_THREAD_ID;
+    event.sigev_signo            = SIGPROF;
+#ifdef sigev_notify_thread_id
+    event.sigev_notify_thread_id = gettid();
+#else
+    event._sigev_un._tid = gettid(); // older glibc does not name the field
+#endif
+    if (timer_create(CLOCK_MONOTONIC, &event, &timer) != 0)
+        return false;
+
+    this->frequency = frequency;
+    active          = this;
+    running         = true;
+    drainer         = std::thread([this] {
+        while (running.load()) {
+            std::this_thread::sleep_for(DRAIN_PERIOD);
+            drain();
+        }
+    });
+
+    const long        period     = 1000000000l / frequency; // nanoseconds
+    struct itimerspec interval   = {};
+    interval.it_interval.tv_sec  = period / 1000000000l;
+    interval.it_interval.tv_nsec = period % 1000000000l;
+    interval.it_value            = interval.it_interval;
+    timer_settime(timer, 0, &interval, nullptr);
+    return true;
+}
+
+void lox::Sampler::stop() {
+    if (!running)
+        return;
+    timer_delete(timer);
+    signal(SIGPROF, SIG_IGN);
+    active  = nullptr;
+    running = false;
+    drainer.join();
+    drain();
+}
+
+void lox::Sampler::report(std::ostream& out) {
+    stop();
+    std::map<const FnStmt*, size_t> self; // samples taken while a function was the innermost one
+    for (const auto& [stack, count] : stacks)
+        self[stack.empty() ? nullptr : stack.back()] += count;
+    std::vector<std::pair<const FnStmt*, size_t>> functions(self.begin(), self.end());
+    std::stable_sort(functions.begin(), functions.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    out << std::fixed << std::setprecision(1);
+    out << "[sample] " << samples << " samples at " << frequency << " Hz, " << dropped.load() << " dropped\n";
+    out << "[sample] " << std::setw(10) << "samples" << std::setw(8) << "self %" << "  function\n";
+    for (const auto& [function, count] : functions)
+        out << "[sample] " << std::setw(10) << count << std::setw(8) << 100.0 * count / samples << "  " << label(function)
+            << "\n";
+
+    std::vector<size_t> hot(lines.size());
+    std::iota(hot.begin(), hot.end(), 0);
+    std::stable_sort(hot.begin(), hot.end(), [this](size_t a, size_t b) { return lines[a] > lines[b]; });
+    out << "[sample] " << std::setw(10) << "samples" << "  line\n";
+    for (size_t i = 0; i < hot.size() and i < REPORTED_LINES and lines[hot[i]] > 0; i++)
+        out << "[sample] " << std::setw(10) << lines[hot[i]] << "  " << hot[i] << "\n";
+}
+
+void lox::Sampler::write_folded(std::ostream& out) {
+    stop();
+    for (const auto& [stack, count] : stacks) {
+        out << label(nullptr);
+        for (const FnStmt* function : stack)
+            out << ";" << label(function);
+        out << " " << count << "\n";
+    }
+}
@@ -4,6 +4,76 @@
 #include "lox.hpp"
 #include "token.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr lox::TokenType keyword(std::string_view word, size_t start, std::string_view rest, lox::TokenType type) {
+    return word.size() == start + rest.size() and word.substr(start) == rest ? type : lox::IDENTIFIER;
+}
+
+// a switch over the leading letters picks the only keyword a word can be, so classifying it never hashes or allocates
+constexpr lox::TokenType keyword(std::string_view word) {
+    switch (word[0]) {
+    case 'a':
+        return keyword(word, 1, "nd", lox::AND);
+    case 'c':
+        return keyword(word, 1, "lass", lox::CLASS);
+    case 'e':
+        return keyword(word, 1, "lse", lox::ELSE);
+    case 'f':
+        if (word.size() > 1)
+            switch (word[1]) {
+            case 'a':
+                return keyword(word, 2, "lse", lox::FALSE);
+            case 'o':
+                return keyword(word, 2, "r", lox::FOR);
+            case 'u':
+                return keyword(word, 2, "n", lox::FUN);
+            }
+        break;
+    case 'i':
+        return keyword(word, 1, "f", lox::IF);
+    case 'n':
+        return keyword(word, 1, "il", lox::NIL);
+    case 'o':
+        return keyword(word, 1, "r", lox::OR);
+    case 'p':
+        return keyword(word, 1, "rint", lox::PRINT);
+    case 'r':
+        return keyword(word, 1, "eturn", lox::RETURN);
+    case 's':
+        return keyword(word, 1, "uper", lox::SUPER);
+    case 't':
+        if (word.size() > 1)
+            switch (word[1]) {
+            case 'h':
+                return keyword(word, 2, "is", lox::THIS);
+            case 'r':
+                return keyword(word, 2, "ue", lox::TRUE);
+            }
+        break;
+    case 'v':
+        return keyword(word, 1, "ar", lox::VAR);
+    case 'w':
+        return keyword(word, 1, "hile", lox::WHILE);
+    }
+    return lox::IDENTIFIER;
+}
+
+static_assert(keyword("fun") == lox::FUN and keyword("f") == lox::IDENTIFIER and keyword("thiss") == lox::IDENTIFIER);
+
+};
+
 char lox::Scanner::advance() {
     return *current++;
 }
@@ -28,11 +98,11 @@ char lox::Scanner::peek_next() const {
 }
 
 void lox::Scanner::add_token(const lox::TokenType type) {
-    add_token(type, std::monostate{});
+    add_token(type, Value{});
 }
 
 void lox::Scanner::add_token(const lox::TokenType type, lox::Value literal) {
-    tokens.emplace_back(type, source.substr(start - src_start, current - start), std::move(literal), line);
+    tokens.emplace_back(type, std::string_view(start, current), std::move(literal), line);
 }
 
 bool lox::Scanner::is_digit(const char ch) const {
@@ -47,15 +117,72 @@ bool lox::Scanner::is_alnum_or_underscore(const char ch) const {
     return is_digit(ch) or is_alpha_or_underscore(ch);
 }
 
-void lox::Scanner::check_string() {
-    while (peek() != '"' and current != src_end)
+// the skip functions below look at 16 bytes at a time where sse2 is available, the scalar loops finish the last
+// few bytes so nothing past the end of the source is ever read
+
+void lox::Scanner::skip_blanks() {
+#ifdef __SSE2__
+    while (src_end - current >= 16) {
+        const __m128i chunk    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+        const __m128i newlines = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+        const __m128i blanks   = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')), newlines)
+        );
+        const unsigned others = ~_mm_movemask_epi8(blanks) & 0xffff;
+        const unsigned length = others ? __builtin_ctz(others) : 16;
+        line += __builtin_popcount(_mm_movemask_epi8(newlines) & ((1u << length) - 1));
+        current += length;
+        if (others)
+            return;
+    }
+#endif
+    for (char ch = peek(); ch == ' ' or ch == '\t' or ch == '\r' or ch == '\n'; ch = peek()) {
+        if (ch == '\n')
+            line++;
+        current++;
+    }
+}
+
+void lox::Scanner::skip_comment() {
+    const void* newline = std::memchr(current, '\n', src_end - current);
+    current             = newline ? static_cast<const char*>(newline) : src_end;
+}
+
+void lox::Scanner::skip_identifier() {
+#ifdef __SSE2__
+    while (src_end - current >= 16) {
+        const __m128i chunk  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+        const __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20)); // lowercases letters, bytes >= 0x80 stay negative
+        const __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+        const __m128i letters =
+            _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+        const __m128i word   = _mm_or_si128(_mm_or_si128(digits, letters), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+        const unsigned others = ~_mm_movemask_epi8(word) & 0xffff;
+        if (others) {
+            current += __builtin_ctz(others);
+            return;
+        }
+        current += 16;
+    }
+#endif
+    while (is_alnum_or_underscore(peek()))
         advance();
+}
+
+void lox::Scanner::check_string() {
+    const void* quote = std::memchr(current, '"', src_end - current);
+    current           = quote ? static_cast<const char*>(quote) : src_end;
     if (current == src_end) {
-        error("Unterminated string", line);
+        if (more) {
+            open      = start;
+            open_line = line;
+        } else
+            scan_error("Unterminated string");
         return;
     }
     advance();
-    add_token(STRING, source.substr(start + 1 - src_start, current - start - 2));
+    add_token(STRING, chunk ? Value{} : Value(std::string_view(start + 1, current - 1)));
 }
 
 void lox::Scanner::check_number() {
@@ -66,17 +193,21 @@ void lox::Scanner::check_number() {
         while (is_digit(peek()))
             advance();
     }
-    add_token(NUMBER, std::stod(source.substr(start - src_start, current - start)));
+    double number = 0;
+    // from_chars leaves the number alone when it is out of range, strtod rounds it to infinity or towards zero instead
+    if (std::from_chars(start, current, number).ec == std::errc::result_out_of_range)
+        number = std::strtod(std::string(start, current).c_str(), nullptr);
+    add_token(NUMBER, number);
 }
 
 void lox::Scanner::check_identifier() {
-    while (is_alnum_or_underscore(peek()))
-        advance();
-    std::string value = source.substr(start - src_start, current - start);
-    if (keywords.find(value) == keywords.end())
-        add_token(IDENTIFIER, std::move(value));
-    else
-        add_token(lox::keywords[value]);
+    skip_identifier();
+    const std::string_view value(start, current);
+    if (const TokenType type = keyword(value); type != IDENTIFIER) {
+        add_token(type);
+        return;
+    }
+    tokens.emplace_back(IDENTIFIER, value, Value{}, line, chunk ? nullptr : LoxString::intern(value));
 }
 
 void lox::Scanner::scan_token() {
@@ -94,6 +225,15 @@ void lox::Scanner::scan_token() {
     case '}':
         add_token(RIGHT_CURLY);
         break;
+    case '[':
+        add_token(LEFT_BRACKET);
+        break;
+    case ']':
+        add_token(RIGHT_BRACKET);
+        break;
+    case ':':
+        add_token(COLON);
+        break;
     case ',':
         add_token(COMMA);
         break;
@@ -126,17 +266,18 @@ void lox::Scanner::scan_token() {
         break;
     case '/':
         if (peek() == '/')
-            while (peek() != '\n' and current != src_end)
-                advance();
+            skip_comment();
         else
             add_token(SLASH);
         break;
     case ' ':
     case '\r':
     case '\t':
+        skip_blanks();
         break;
     case '\n':
         line++;
+        skip_blanks();
         break;
     case '"':
         check_string();
@@ -147,15 +288,91 @@ void lox::Scanner::scan_token() {
         else if (is_alpha_or_underscore(ch))
             check_identifier();
         else
-            error("Unexpected character", line);
+            scan_error("Unexpected character");
     }
 }
 
-std::vector<lox::Token> lox::Scanner::scan_tokens() {
+void lox::Scanner::scan_error(const std::string& message) {
+    if (chunk)
+        errors.emplace_back(line, message);
+    else
+        error(message, line);
+}
+
+void lox::Scanner::scan() {
     while (current != src_end) {
         start = current;
         scan_token();
     }
-    tokens.emplace_back(END, "", std::monostate{}, line);
+}
+
+std::vector<lox::Token> lox::Scanner::scan_tokens() {
+    scan();
+    tokens.emplace_back(END, "", Value{}, line);
     return std::move(tokens);
 }
+
+// appends the tokens of a chunk that starts on the given line, interning what the worker could not
+void lox::Scanner::stitch(std::vector<lox::Token>& out, const unsigned first_line) const {
+    for (const auto& [line, message] : errors)
+        error(message, line + first_line - 1);
+    for (const Token& token : tokens) {
+        const unsigned line = token.line + first_line - 1;
+        if (token.type == IDENTIFIER)
+            out.emplace_back(IDENTIFIER, token.lexeme, Value{}, line, LoxString::intern(token.lexeme));
+        else if (token.type == STRING)
+            out.emplace_back(STRING, token.lexeme, Value(token.lexeme.substr(1, token.lexeme.size() - 2)), line);
+        else
+            out.emplace_back(token.type, token.lexeme, token.literal, line);
+    }
+}
+
+// chunks start right after a newline, so only a string can span two of them. when one does the next chunk was scanned
+// from the wrong state: its tokens are dropped and the text from the opening quote on is scanned again
+std::vector<lox::Token> lox::Scanner::scan_parallel(std::string_view source, const unsigned threads) {
+    const char*              end = source.data() + source.size();
+    std::vector<const char*> bounds{source.data()};
+    for (unsigned i = 1; i < threads; i++) {
+        const char* split   = std::max(bounds.back(), source.data() + source.size() / threads * i);
+        const void* newline = std::memchr(split, '\n', end - split);
+        if (newline == nullptr)
+            break;
+        bounds.push_back(static_cast<const char*>(newline) + 1);
+    }
+    bounds.push_back(end);
+    const size_t count = bounds.size() - 1;
+
+    std::vector<Scanner> chunks;
+    chunks.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        chunks.push_back(Scanner(std::string_view(bounds[i], bounds[i + 1]), i + 1 < count));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < count; i++)
+        workers.emplace_back([&chunks, i] { chunks[i].scan(); });
+    chunks[0].scan();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    size_t size = 1;
+    for (const Scanner& chunk : chunks)
+        size += chunk.tokens.size();
+    std::vector<Token> tokens;
+    tokens.reserve(size);
+    unsigned line = 1; // the line the next chunk starts on
+    for (size_t i = 0; i < count; i++) {
+        const Scanner*           chunk = &chunks[i];
+        std::unique_ptr<Scanner> rescan;
+        chunk->stitch(tokens, line);
+        while (chunk->open) {
+            line += chunk->open_line - 1;
+            i++;
+            rescan = std::make_unique<Scanner>(Scanner(std::string_view(chunk->open, bounds[i + 1]), i + 1 < count));
+            rescan->scan();
+            chunk = rescan.get();
+            chunk->stitch(tokens, line);
+        }
+        line += chunk->line - 1;
+    }
+    tokens.emplace_back(END, "", Value{}, line);
+    return tokens;
+}
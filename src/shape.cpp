@@ -0,0 +1,22 @@
+#include "shape.hpp"
+
+lox::Shape* lox::Shape::root() {
+    static Shape* root = new Shape();
+    return root;
+}
+
+int lox::Shape::lookup(const lox::LoxString* name) const {
+    if (auto it = slots.find(name); it != slots.end())
+        return it->second;
+    return -1;
+}
+
+lox::Shape* lox::Shape::add(lox::LoxString* name) {
+    if (auto it = transitions.find(name); it != transitions.end())
+        return it->second.get();
+    Shape* shape = new Shape();
+    shape->slots = slots;
+    shape->slots.emplace(Ref<LoxString>(name), size());
+    transitions.emplace(Ref<LoxString>(name), std::unique_ptr<Shape>(shape));
+    return shape;
+}
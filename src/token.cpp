@@ -11,11 +11,11 @@ std::string lox::Token::to_string() const {
         oss << line << std::setw(15) << "end of file ";
         break;
     case NUMBER:
-        oss << line << std::setw(15) << lox::tokentypes[type] << std::setw(10) << lexeme << std::setw(10) << " (" << std::get<double>(literal)
+        oss << line << std::setw(15) << lox::tokentypes[type] << std::setw(10) << lexeme << std::setw(10) << " (" << literal.as_number()
             << ") ";
         break;
     case STRING:
-        oss << line << std::setw(15) << lox::tokentypes[type] << std::setw(10) << lexeme << std::setw(10) << " (" << std::get<std::string>(literal)
+        oss << line << std::setw(15) << lox::tokentypes[type] << std::setw(10) << lexeme << std::setw(10) << " (" << literal.as_string()
             << ") ";
         break;
     case IDENTIFIER:
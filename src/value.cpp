@@ -0,0 +1,25 @@
+#include "value.hpp"
+
+namespace {
+
+// entries do not own their strings, a string removes itself when its last reference goes away. the table is never
+// destroyed since values held by globals may still be released after static destruction starts
+std::unordered_map<std::string_view, lox::LoxString*>& strings() {
+    static auto* table = new std::unordered_map<std::string_view, lox::LoxString*>();
+    return *table;
+}
+
+};
+
+lox::Ref<lox::LoxString> lox::LoxString::intern(std::string_view chars) {
+    auto& table = strings();
+    if (auto it = table.find(chars); it != table.end())
+        return Ref<LoxString>(it->second);
+    LoxString* string = new LoxString(chars, std::hash<std::string_view>{}(chars));
+    table.emplace(string->chars, string);
+    return Ref<LoxString>(string);
+}
+
+lox::LoxString::~LoxString() {
+    strings().erase(chars);
+}
@@ -0,0 +1,624 @@
+#include "vm.hpp"
+
+#include "error.hpp"
+#include "lox_class.hpp"
+#include "lox_instance.hpp"
+#include "lox_list.hpp"
+#include "lox_map.hpp"
+#include "native.hpp"
+#include "stats.hpp"
+
+#include <limits>
+
+lox::VM::VM(lox::Interpreter& interpreter) : interpreter(interpreter) {
+    for (const auto& [name, value] : interpreter.globals.values) {
+        Global& global = globals[global_slot(name->chars)];
+        global.value   = value;
+        global.defined = true;
+    }
+}
+
+void lox::VM::push(lox::Value value) {
+    *stack_top++ = std::move(value);
+}
+
+lox::Value lox::VM::pop() {
+    return std::move(*--stack_top);
+}
+
+void lox::VM::unwind(lox::Value* to) {
+    while (stack_top > to)
+        *--stack_top = {};
+}
+
+// the line of the byte `back` bytes before the instruction pointer, the last one read by default
+unsigned lox::VM::line(const size_t back) const {
+    const CallFrame& frame = frames[frame_count - 1];
+    const Chunk&     chunk = frame.closure->function->chunk;
+    return chunk.lines[frame.ip - chunk.code.data() - back];
+}
+
+lox::RuntimeError lox::VM::error(const std::string& message) const {
+    return RuntimeError(line(), message);
+}
+
+// an invoke keeps the line of its method name on the name operand, right before the argument count
+lox::RuntimeError lox::VM::property_error(const std::string& message) const {
+    return RuntimeError(line(2), message);
+}
+
+void lox::VM::call_closure(lox::VmClosure* closure, const size_t argc) {
+    if (argc != closure->function->arity)
+        throw error("Expected " + std::to_string(closure->function->arity) + " arguments but got " + std::to_string(argc));
+    if (frame_count == FRAMES_MAX or stack_top + STACK_HEADROOM > stack.get() + STACK_MAX)
+        throw error("Stack overflow");
+    CallFrame& frame = frames[frame_count++];
+    frame.closure    = closure;
+    frame.ip         = closure->function->chunk.code.data();
+    frame.slots      = stack_top - argc - 1;
+}
+
+void lox::VM::call_value(const lox::Value& callee, const size_t argc) {
+    if (!callee.is_callable())
+        throw error("Can only call functions and methods");
+    LoxCallable* callable = callee.as<LoxCallable>();
+    switch (callable->type) {
+    case ObjectType::CLOSURE:
+        call_closure(static_cast<VmClosure*>(callable), argc);
+        return;
+    case ObjectType::BOUND_METHOD: {
+        VmBoundMethod* bound    = static_cast<VmBoundMethod*>(callable);
+        VmClosure*     method   = bound->method.get(); // kept alive by the receiver's class
+        Value          receiver = bound->receiver;
+        stack_top[-argc - 1]    = std::move(receiver);
+        call_closure(method, argc);
+        return;
+    }
+    case ObjectType::CLASS: {
+        LoxClass*        klass = static_cast<LoxClass*>(callable);
+        LoxCallable*     init  = klass->initializer().get();
+        stack_top[-argc - 1]   = make_ref<LoxInstance>(Ref<LoxClass>(klass));
+        if (init != nullptr)
+            call_closure(static_cast<VmClosure*>(init), argc);
+        else if (argc != 0)
+            throw error("Expected 0 arguments but got " + std::to_string(argc));
+        return;
+    }
+    default:
+        break;
+    }
+    if (argc != callable->arity())
+        throw error("Expected " + std::to_string(callable->arity()) + " arguments but got " + std::to_string(argc));
+    Value result;
+    try {
+        result = callable->call(interpreter, Arguments(stack_top - argc, argc));
+    } catch (const NativeError& native) {
+        throw error(native.what());
+    }
+    unwind(stack_top - argc - 1);
+    push(std::move(result));
+}
+
+void lox::VM::invoke(const lox::LoxString* name, const size_t argc) {
+    const Value& receiver = stack_top[-argc - 1];
+    if (receiver.is_list() or receiver.is_map()) {
+        invoke_builtin(name, argc);
+        return;
+    }
+    if (!receiver.is_instance())
+        throw property_error("Only instances have properties.");
+    LoxInstance& instance = *receiver.as<LoxInstance>();
+    if (Value* field = instance.field(name)) {
+        Value callee         = *field;
+        stack_top[-argc - 1] = callee;
+        call_value(callee, argc);
+        return;
+    }
+    if (!invoke_from_class(*instance.klass, name, argc))
+        throw property_error("Undefined Property");
+}
+
+// a list or map method gets its receiver straight from the stack, no bound method is made
+void lox::VM::invoke_builtin(const lox::LoxString* name, const size_t argc) {
+    LoxCallable* method = builtin_method(stack_top[-argc - 1], name);
+    if (method == nullptr)
+        throw property_error("Undefined Property");
+    if (argc != method->arity())
+        throw error("Expected " + std::to_string(method->arity()) + " arguments but got " + std::to_string(argc));
+    Value result;
+    try {
+        result = method->call_method(interpreter, stack_top[-argc - 1], Arguments(stack_top - argc, argc));
+    } catch (const NativeError& native) {
+        throw error(native.what());
+    }
+    unwind(stack_top - argc - 1);
+    push(std::move(result));
+}
+
+bool lox::VM::invoke_from_class(lox::LoxClass& klass, const lox::LoxString* name, const size_t argc) {
+    auto method = klass.methods.find(name);
+    if (method == klass.methods.end())
+        return false;
+    call_closure(static_cast<VmClosure*>(method->second.get()), argc); // classes built by the vm only ever hold vm closures
+    return true;
+}
+
+lox::Ref<lox::Upvalue> lox::VM::capture_upvalue(lox::Value* local) {
+    Ref<Upvalue>* link = &open_upvalues;
+    while (*link != nullptr and (*link)->location > local)
+        link = &(*link)->next;
+    if (*link != nullptr and (*link)->location == local)
+        return *link;
+    Ref<Upvalue> upvalue = make_ref<Upvalue>(local);
+    upvalue->next        = std::move(*link);
+    *link                = upvalue;
+    return upvalue;
+}
+
+void lox::VM::close_upvalues(lox::Value* last) {
+    while (open_upvalues != nullptr and open_upvalues->location >= last) {
+        Ref<Upvalue> upvalue = std::move(open_upvalues);
+        upvalue->closed      = *upvalue->location;
+        upvalue->location    = &upvalue->closed;
+        open_upvalues        = std::move(upvalue->next);
+    }
+}
+
+lox::Value lox::VM::run(const size_t exit_depth) {
+    CallFrame*     frame     = &frames[frame_count - 1];
+    const uint8_t* ip        = frame->ip;
+    const Value*   constants = frame->closure->function->chunk.constants.data();
+    InlineCache*   caches    = frame->closure->function->chunk.caches.data();
+
+    auto read_byte = [&]() -> uint8_t {
+        return *ip++;
+    };
+    auto read_short = [&]() -> uint16_t {
+        ip += 2;
+        return ip[-2] << 8 | ip[-1];
+    };
+    auto read_name = [&]() -> LoxString* {
+        return constants[read_short()].as<LoxString>();
+    };
+    auto peek = [&](const size_t distance) -> Value& {
+        return stack_top[-1 - distance];
+    };
+    // the frame pointer is only written back when something may inspect it or push a new frame
+    auto save = [&]() {
+        frame->ip = ip;
+    };
+    auto load = [&]() {
+        frame     = &frames[frame_count - 1];
+        ip        = frame->ip;
+        constants = frame->closure->function->chunk.constants.data();
+        caches    = frame->closure->function->chunk.caches.data();
+    };
+    auto fail = [&](const std::string& message) {
+        save();
+        return error(message);
+    };
+    auto numbers = [&](double& l, double& r) {
+        if (!peek(1).is_number() or !peek(0).is_number())
+            throw fail("Operands must be numbers");
+        l = peek(1).as_number();
+        r = peek(0).as_number();
+        pop();
+    };
+
+    for (;;) {
+        switch (read_byte()) {
+        case OP_CONSTANT:
+            push(constants[read_short()]);
+            break;
+        case OP_NIL:
+            push({});
+            break;
+        case OP_TRUE:
+            push(true);
+            break;
+        case OP_FALSE:
+            push(false);
+            break;
+        case OP_POP:
+            pop();
+            break;
+        case OP_GET_LOCAL:
+            push(frame->slots[read_byte()]);
+            break;
+        case OP_SET_LOCAL:
+            frame->slots[read_byte()] = peek(0);
+            break;
+        case OP_GET_GLOBAL: {
+            const uint16_t slot = read_short();
+            if (!globals[slot].defined)
+                throw fail("Undefined variable '" + global_names[slot] + "'");
+            push(globals[slot].value);
+            break;
+        }
+        case OP_DEFINE_GLOBAL: {
+            Global& global = globals[read_short()];
+            global.value   = pop();
+            global.defined = true;
+            break;
+        }
+        case OP_SET_GLOBAL: {
+            const uint16_t slot = read_short();
+            if (!globals[slot].defined)
+                throw fail("Undefined variable '" + global_names[slot] + "'");
+            globals[slot].value = peek(0);
+            break;
+        }
+        case OP_GET_UPVALUE:
+            push(*frame->closure->upvalues[read_byte()]->location);
+            break;
+        case OP_SET_UPVALUE:
+            *frame->closure->upvalues[read_byte()]->location = peek(0);
+            break;
+        case OP_GET_PROPERTY: {
+            LoxString*   name  = read_name();
+            InlineCache& cache = caches[read_short()];
+            if (peek(0).is_list() or peek(0).is_map()) {
+                LoxCallable* method = builtin_method(peek(0), name);
+                if (method == nullptr)
+                    throw fail("Undefined Property");
+                peek(0) = make_ref<BoundBuiltinMethod>(peek(0), Ref<LoxCallable>(method));
+                break;
+            }
+            if (!peek(0).is_instance())
+                throw fail("Only instances have properties.");
+            Value        object   = pop();
+            LoxInstance* instance = object.as<LoxInstance>();
+            if (Value* field = instance->field(name, cache)) {
+                push(*field);
+                break;
+            }
+            Ref<LoxCallable> method = instance->klass->find_method(name);
+            if (method == nullptr)
+                throw fail("Undefined Property");
+            push(method->bind(Ref<LoxInstance>(instance)));
+            break;
+        }
+        case OP_SET_PROPERTY: {
+            LoxString*   name  = read_name();
+            InlineCache& cache = caches[read_short()];
+            if (!peek(1).is_instance())
+                throw fail("Only instances have fields");
+            if (LoxClass* klass = peek(1).as<LoxInstance>()->klass.get(); klass->frozen)
+                throw fail("Fields of " + klass->name + " are read-only");
+            Value value = pop();
+            pop().as<LoxInstance>()->set_field(name, value, cache);
+            push(std::move(value));
+            break;
+        }
+        case OP_GET_SUPER: {
+            LoxString*       name       = read_name();
+            Value            superclass = pop();
+            Ref<LoxCallable> method     = superclass.as<LoxClass>()->find_method(name);
+            if (method == nullptr)
+                throw fail("Undefined property '" + name->chars + "'");
+            push(method->bind(Ref<LoxInstance>(pop().as<LoxInstance>())));
+            break;
+        }
+        case OP_EQUAL: {
+            const bool equal = interpreter.is_equal(peek(1), peek(0));
+            pop();
+            peek(0) = equal;
+            break;
+        }
+        case OP_NOT_EQUAL: {
+            const bool equal = interpreter.is_equal(peek(1), peek(0));
+            pop();
+            peek(0) = !equal;
+            break;
+        }
+        case OP_GREATER: {
+            double l, r;
+            numbers(l, r);
+            peek(0) = l > r;
+            break;
+        }
+        case OP_GREATER_EQUAL: {
+            double l, r;
+            numbers(l, r);
+            peek(0) = l >= r;
+            break;
+        }
+        case OP_LESSER: {
+            double l, r;
+            numbers(l, r);
+            peek(0) = l < r;
+            break;
+        }
+        case OP_LESSER_EQUAL: {
+            double l, r;
+            numbers(l, r);
+            peek(0) = l <= r;
+            break;
+        }
+        case OP_ADD: {
+            Value& left  = peek(1);
+            Value& right = peek(0);
+            if (left.is_number() and right.is_number()) {
+                const double sum = left.as_number() + right.as_number();
+                pop();
+                peek(0) = sum;
+            } else if (left.is_string() or right.is_string()) {
+                std::string concatenated = interpreter.stringfy(left) + interpreter.stringfy(right);
+                pop();
+                peek(0) = std::move(concatenated);
+            } else {
+                throw fail("cannot add " + interpreter.stringfy(left) + " and " + interpreter.stringfy(right));
+            }
+            break;
+        }
+        case OP_SUBTRACT: {
+            double l, r;
+            numbers(l, r);
+            peek(0) = l - r;
+            break;
+        }
+        case OP_MULTIPLY: {
+            double l, r;
+            numbers(l, r);
+            peek(0) = l * r;
+            break;
+        }
+        case OP_DIVIDE: {
+            double l, r;
+            numbers(l, r);
+            peek(0) = l / r;
+            break;
+        }
+        case OP_NOT:
+            peek(0) = !interpreter.is_truthy(peek(0));
+            break;
+        case OP_NEGATE:
+            if (!peek(0).is_number())
+                throw fail("Operand must be a number");
+            peek(0) = -peek(0).as_number();
+            break;
+        case OP_PRINT:
+            std::cout << interpreter.stringfy(pop()) << "\n";
+            break;
+        case OP_JUMP: {
+            const uint16_t offset = read_short();
+            ip += offset;
+            break;
+        }
+        case OP_JUMP_IF_FALSE: {
+            const uint16_t offset = read_short();
+            if (!interpreter.is_truthy(peek(0)))
+                ip += offset;
+            break;
+        }
+        case OP_LOOP: {
+            const uint16_t offset = read_short();
+            ip -= offset;
+            break;
+        }
+        case OP_CALL: {
+            const uint8_t argc = read_byte();
+            save();
+            call_value(peek(argc), argc);
+            load();
+            break;
+        }
+        case OP_INVOKE: {
+            LoxString*    name = read_name();
+            const uint8_t argc = read_byte();
+            save();
+            invoke(name, argc);
+            load();
+            break;
+        }
+        case OP_SUPER_INVOKE: {
+            LoxString*    name       = read_name();
+            const uint8_t argc       = read_byte();
+            Value         superclass = pop();
+            save();
+            if (!invoke_from_class(*superclass.as<LoxClass>(), name, argc))
+                throw property_error("Undefined property '" + name->chars + "'");
+            load();
+            break;
+        }
+        case OP_CLOSURE: {
+            Ref<VmClosure> closure = make_ref<VmClosure>(*this, frame->closure->function->chunk.functions[read_short()]);
+            for (auto& upvalue : closure->upvalues) {
+                const uint8_t is_local = read_byte();
+                const uint8_t index    = read_byte();
+                upvalue                = is_local ? capture_upvalue(frame->slots + index) : frame->closure->upvalues[index];
+            }
+            push(std::move(closure));
+            break;
+        }
+        case OP_CLOSE_UPVALUE:
+            close_upvalues(stack_top - 1);
+            pop();
+            break;
+        case OP_RETURN: {
+            Value result = pop();
+            close_upvalues(frame->slots);
+            unwind(frame->slots);
+            frame_count--;
+            if (frame_count == exit_depth)
+                return result;
+            push(std::move(result));
+            load();
+            break;
+        }
+        case OP_CLASS:
+            push(make_ref<LoxClass>(read_name()->chars, SymbolMap<Ref<LoxCallable>>()));
+            break;
+        case OP_INHERIT: {
+            const Value& superclass = peek(1);
+            if (!superclass.is_object() or superclass.as_object()->type != ObjectType::CLASS)
+                throw fail("superclass must be a class");
+            peek(0).as<LoxClass>()->inherit(Ref<LoxClass>(superclass.as<LoxClass>()));
+            pop();
+            break;
+        }
+        case OP_METHOD: {
+            LoxString* name   = read_name();
+            Value      method = pop();
+            peek(0).as<LoxClass>()->add_method(Ref<LoxString>(name), Ref<LoxCallable>(method.as<LoxCallable>()));
+            break;
+        }
+        case OP_LIST: {
+            Ref<LoxList> list = make_ref<LoxList>();
+            list->elements.reserve(read_short());
+            push(std::move(list));
+            break;
+        }
+        case OP_APPEND: {
+            Value element = pop();
+            peek(0).as<LoxList>()->elements.push_back(std::move(element));
+            break;
+        }
+        case OP_MAP: {
+            Ref<LoxMap> map = make_ref<LoxMap>();
+            map->reserve(read_short());
+            push(std::move(map));
+            break;
+        }
+        case OP_INSERT: {
+            try {
+                peek(2).as<LoxMap>()->set(peek(1), peek(0));
+            } catch (const NativeError& native) {
+                throw fail(native.what());
+            }
+            pop();
+            pop();
+            break;
+        }
+        case OP_GET_INDEX: {
+            if (!peek(1).is_list() and !peek(1).is_map())
+                throw fail("Only lists and maps can be indexed");
+            try {
+                Value element;
+                if (peek(1).is_list())
+                    element = peek(1).as<LoxList>()->at(peek(0));
+                else if (Value* value = peek(1).as<LoxMap>()->find(peek(0)))
+                    element = *value;
+                pop();
+                peek(0) = std::move(element);
+            } catch (const NativeError& native) {
+                throw fail(native.what());
+            }
+            break;
+        }
+        case OP_SET_INDEX: {
+            if (!peek(2).is_list() and !peek(2).is_map())
+                throw fail("Only lists and maps can be indexed");
+            try {
+                if (peek(2).is_list())
+                    peek(2).as<LoxList>()->at(peek(1)) = peek(0);
+                else
+                    peek(2).as<LoxMap>()->set(peek(1), peek(0));
+            } catch (const NativeError& native) {
+                throw fail(native.what());
+            }
+            Value value = pop();
+            pop();
+            peek(0) = std::move(value);
+            break;
+        }
+        }
+    }
+}
+
+void lox::VM::interpret(std::shared_ptr<lox::Prototype> script) {
+    Ref<VmClosure> closure = make_ref<VmClosure>(*this, std::move(script));
+    push(closure);
+    try {
+        call_closure(closure.get(), 0);
+        run(0);
+    } catch (const RuntimeError& error) {
+        runtime_error(error);
+        close_upvalues(stack.get());
+        unwind(stack.get());
+        frame_count = 0;
+    }
+}
+
+lox::Value lox::VM::call(lox::VmClosure& closure, lox::Value receiver, lox::Arguments arguments) {
+    push(std::move(receiver));
+    for (Value& argument : arguments)
+        push(std::move(argument));
+    const size_t depth = frame_count;
+    call_closure(&closure, arguments.size());
+    return run(depth);
+}
+
+uint16_t lox::VM::global_slot(std::string_view name) {
+    if (auto it = global_slots.find(std::string(name)); it != global_slots.end())
+        return it->second;
+    if (globals.size() > std::numeric_limits<uint16_t>::max()) {
+        lox::error("Too many global variables", 0);
+        return 0;
+    }
+    globals.emplace_back();
+    global_names.emplace_back(name);
+    return global_slots[std::string(name)] = globals.size() - 1;
+}
+
+void lox::Upvalue::trace(lox::Tracer& tracer) {
+    tracer(closed); // an open upvalue's variable belongs to the stack
+    tracer(next);
+}
+
+void lox::Upvalue::clear() {
+    closed = {};
+    next   = nullptr;
+}
+
+void lox::VmClosure::trace(lox::Tracer& tracer) {
+    for (const Ref<Upvalue>& upvalue : upvalues)
+        tracer(upvalue);
+}
+
+void lox::VmClosure::clear() {
+    upvalues.clear();
+}
+
+size_t lox::VmClosure::arity() {
+    return function->arity;
+}
+
+lox::Ref<lox::LoxCallable> lox::VmClosure::bind(lox::Ref<lox::LoxInstance> instance) {
+    runtime_stats().binds++;
+    return make_ref<VmBoundMethod>(std::move(instance), Ref<VmClosure>(this));
+}
+
+lox::Value lox::VmClosure::call(lox::Interpreter&, lox::Arguments arguments) {
+    return vm.call(*this, {}, arguments);
+}
+
+lox::Value lox::VmClosure::call_method(lox::Interpreter&, const lox::Value& receiver, lox::Arguments arguments) {
+    return vm.call(*this, receiver, arguments);
+}
+
+std::string lox::VmClosure::to_string() const {
+    return "<fn " + function->name + ">";
+}
+
+void lox::VmBoundMethod::trace(lox::Tracer& tracer) {
+    tracer(receiver);
+    tracer(method);
+}
+
+void lox::VmBoundMethod::clear() {
+    receiver = {};
+    method   = nullptr;
+}
+
+size_t lox::VmBoundMethod::arity() {
+    return method->arity();
+}
+
+lox::Value lox::VmBoundMethod::call(lox::Interpreter&, lox::Arguments arguments) {
+    return method->vm.call(*method, receiver, arguments);
+}
+
+std::string lox::VmBoundMethod::to_string() const {
+    return method->to_string();
+}